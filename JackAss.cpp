@@ -25,6 +25,15 @@
 #endif
 
 #include "jackbridge/JackBridge.cpp"
+#include "JackAssAudio.hpp"
+#include "JackAssCapture.hpp"
+#include "JackAssCv.hpp"
+#include "JackAssHub.hpp"
+#include "JackAssShaper.hpp"
+#include "JackAssShm.hpp"
+#include "JackAssTransform.hpp"
+#include "JackAssVendor.hpp"
+#include "JackAssWorkers.hpp"
 
 #include "public.sdk/source/vst2.x/audioeffect.cpp"
 #include "public.sdk/source/vst2.x/audioeffectx.cpp"
@@ -38,348 +47,2747 @@
 // -------------------------------------------------
 // Parameters
 
-static const unsigned char kParamMap[] = {
-    0x01, 0x02, 0x03, 0x04, 0x05, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
-    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F,
-    0x46, 0x47, 0x48, 0x49, 0x4A, 0x4B, 0x4C, 0x4D, 0x4E, 0x4F,
-    0x50, 0x51, 0x52, 0x53, 0x54, 0x5B, 0x5C, 0x5D, 0x5E, 0x5F
-};
-
-static const int kParamVolume  = 5;
-static const int kParamBalance = 6;
-static const int kParamPan     = 8;
+static const int kMaxParams    = 128; // one per CC
+static const int kParamNameLen = 18+1;
 
-static const int kParamCount   = sizeof(kParamMap);
-#ifdef USE_PROGRAMS
-static const int kProgramCount = 128;
-#else
-static const int kProgramCount = 0;
-#endif
+struct param_info_t {
+    unsigned char cc;
+    float         value; // default
+    const char*   name;
+};
 
-// -------------------------------------------------
-// Data limits
+// built-in map, used unless JACKASS_PARAM_MAP names a map file
+static const param_info_t kDefaultParamMap[] = {
+    { 0x01, 0.0f, "0x01 Modulation" },
+    { 0x02, 0.0f, "0x02 Breath" },
+    { 0x03, 0.0f, "0x03 (Undefined)" },
+    { 0x04, 0.0f, "0x04 Foot" },
+    { 0x05, 0.0f, "0x05 Portamento" },
+    { 0x07, 100.0f/127.0f, "0x07 Volume" },
+    { 0x08, 0.5f, "0x08 Balance" },
+    { 0x09, 0.0f, "0x09 (Undefined)" },
+    { 0x0A, 0.5f, "0x0A Pan" },
+    { 0x0B, 0.0f, "0x0B Expression" },
+    { 0x0C, 0.0f, "0x0C FX Control 1" },
+    { 0x0D, 0.0f, "0x0D FX Control 2" },
+    { 0x0E, 0.0f, "0x0E (Undefined)" },
+    { 0x0F, 0.0f, "0x0F (Undefined)" },
+    { 0x10, 0.0f, "0x10 Gen Purpose 1" },
+    { 0x11, 0.0f, "0x11 Gen Purpose 2" },
+    { 0x12, 0.0f, "0x12 Gen Purpose 3" },
+    { 0x13, 0.0f, "0x13 Gen Purpose 4" },
+    { 0x14, 0.0f, "0x14 (Undefined)" },
+    { 0x15, 0.0f, "0x15 (Undefined)" },
+    { 0x16, 0.0f, "0x16 (Undefined)" },
+    { 0x17, 0.0f, "0x17 (Undefined)" },
+    { 0x18, 0.0f, "0x18 (Undefined)" },
+    { 0x19, 0.0f, "0x19 (Undefined)" },
+    { 0x1A, 0.0f, "0x1A (Undefined)" },
+    { 0x1B, 0.0f, "0x1B (Undefined)" },
+    { 0x1C, 0.0f, "0x1C (Undefined)" },
+    { 0x1D, 0.0f, "0x1D (Undefined)" },
+    { 0x1E, 0.0f, "0x1E (Undefined)" },
+    { 0x1F, 0.0f, "0x1F (Undefined)" },
+    { 0x46, 0.0f, "0x46 Control 1" },  // [Variation]
+    { 0x47, 0.0f, "0x47 Control 2" },  // [Timbre]
+    { 0x48, 0.0f, "0x48 Control 3" },  // [Release]
+    { 0x49, 0.0f, "0x49 Control 4" },  // [Attack]
+    { 0x4A, 0.0f, "0x4A Control 5" },  // [Brightness]
+    { 0x4B, 0.0f, "0x4B Control 6" },  // [Decay]
+    { 0x4C, 0.0f, "0x4C Control 7" },  // [Vib Rate]
+    { 0x4D, 0.0f, "0x4D Control 8" },  // [Vib Depth]
+    { 0x4E, 0.0f, "0x4E Control 9" },  // [Vib Delay]
+    { 0x4F, 0.0f, "0x4F Control 10" }, // [Undefined]
+    { 0x50, 0.0f, "0x50 Gen Purpose 5" },
+    { 0x51, 0.0f, "0x51 Gen Purpose 6" },
+    { 0x52, 0.0f, "0x52 Gen Purpose 7" },
+    { 0x53, 0.0f, "0x53 Gen Purpose 8" },
+    { 0x54, 0.0f, "0x54 Portamento" },
+    { 0x5B, 0.0f, "0x5B FX 1 Depth" }, // [Reverb]
+    { 0x5C, 0.0f, "0x5C FX 2 Depth" }, // [Tremolo]
+    { 0x5D, 0.0f, "0x5D FX 3 Depth" }, // [Chorus]
+    { 0x5E, 0.0f, "0x5E FX 4 Depth" }, // [Detune]
+    { 0x5F, 0.0f, "0x5F FX 5 Depth" }  // [Phaser]
+};
 
-static const int kMaxMidiEvents   = 512;
-static const int kProgramNameSize = 32;
+// per parameter output mode, see JACKASS_PARAM_MODES
+enum ParamMode {
+    kParamMode7Bit  = 0, // classic CC
+    kParamMode14Bit = 1, // MSB on the parameter CC, LSB on CC+32
+    kParamModeNRPN  = 2,
+    kParamModeRPN   = 3
+};
 
-// -------------------------------------------------
-// Midi data
+// CC messages for a full update of a parameter, per mode
+static const int kParamModeMessages[] = { 1, 2, 4, 4 };
+static const int kParamMaxMessages    = 4; // NRPN/RPN select, data entry MSB and LSB
+static const uint16_t kParamUnsent    = 0xFFFF;
 
-struct midi_data_t {
-    unsigned char data[4];
-    unsigned char size;
-    VstInt32 time;
+// mode is "7bit", "14bit", "nrpn:<number>" or "rpn:<number>", returns false for anything else
+static bool parseParamMode(const char* const str, unsigned char& mode, long& number)
+{
+    mode   = kParamMode7Bit;
+    number = 0;
 
-    midi_data_t()
-        : size(0),
-          time(0)
+    if (std::strncmp(str, "14bit", 5) == 0)
     {
-        std::memset(data, 0, 4*sizeof(char));
+        mode = kParamMode14Bit;
+    }
+    else if (std::strncmp(str, "nrpn:", 5) == 0)
+    {
+        mode   = kParamModeNRPN;
+        number = std::strtol(str+5, nullptr, 0);
+    }
+    else if (std::strncmp(str, "rpn:", 4) == 0)
+    {
+        mode   = kParamModeRPN;
+        number = std::strtol(str+4, nullptr, 0);
+    }
+    else if (std::strncmp(str, "7bit", 4) != 0)
+    {
+        return false;
     }
-};
 
-// -------------------------------------------------
-// Global JACK client
+    return true;
+}
 
-static jack_client_t* gJackClient     = nullptr;
-static volatile bool  gNeedMidiResend = false;
+// Parameter map, loaded once at plugin load into flat tables.
+// A map file has one parameter per line, '#' starts a comment:
+//   cc=<0-127> [channel=<1-16>] [default=<0-127>] [mode=<mode>] name=<rest of line>
+struct ParamMap {
+    int           count;
+    unsigned char cc[kMaxParams];
+    unsigned char status[kMaxParams]; // 0xB0 | channel
+    bool          anyChannel[kMaxParams]; // no channel given, midi-in matches all of them
+    float         value[kMaxParams];
+    unsigned char mode[kMaxParams];
+    uint16_t      number[kMaxParams];
+    char          name[kMaxParams][kParamNameLen];
+
+    ParamMap()
+        : count(0)
+    {
+        if (const char* const filename = std::getenv("JACKASS_PARAM_MAP"))
+        {
+            if (load(filename))
+                return;
 
-// -------------------------------------------------
-// single JackAss instance, containing 1 MIDI port
+            count = 0;
+        }
 
-class JackAssInstance
-{
-public:
-    JackAssInstance(jack_port_t* const port)
-        : fPort(port)
-    {
-        pthread_mutex_init(&fMutex, nullptr);
+        for (size_t i=0; i < sizeof(kDefaultParamMap)/sizeof(param_info_t); ++i)
+        {
+            const param_info_t& info(kDefaultParamMap[i]);
+            add(info.cc, -1, info.value, kParamMode7Bit, 0, info.name);
+        }
     }
 
-    ~JackAssInstance()
+    void add(const int newCC, const int channel, const float newValue, const unsigned char newMode, const long newNumber, const char* const newName)
     {
-        pthread_mutex_lock(&fMutex);
-        pthread_mutex_unlock(&fMutex);
-        pthread_mutex_destroy(&fMutex);
+        cc[count]         = (unsigned char)newCC;
+        status[count]     = (unsigned char)(0xB0 | (channel >= 0 ? channel : 0));
+        anyChannel[count] = (channel < 0);
+        value[count]      = newValue;
+        mode[count]       = newMode;
+        number[count]     = uint16_t(newNumber & 0x3FFF);
 
-        if (fPort != nullptr)
-        {
-            if (gJackClient != nullptr)
-                jackbridge_port_unregister(gJackClient, fPort);
+        std::snprintf(name[count], kParamNameLen, "%s", newName);
 
-            fPort = nullptr;
-        }
+        ++count;
     }
 
-    void putEvent(const unsigned char data[4], const unsigned char size, const VstInt32 time)
+    bool load(const char* const filename)
     {
-        pthread_mutex_lock(&fMutex);
+        FILE* const file(std::fopen(filename, "r"));
 
-        for (int i=0; i < kMaxMidiEvents; ++i)
+        if (file == nullptr)
         {
-            if (fData[i].data[0] != 0)
-                continue;
+            std::fprintf(stderr, "JackAss: failed to open parameter map '%s'\n", filename);
+            return false;
+        }
 
-            fData[i].data[0] = data[0];
-            fData[i].data[1] = data[1];
-            fData[i].data[2] = data[2];
-            fData[i].data[3] = data[3];
-            fData[i].size    = size;
-            fData[i].time    = time;
-            break;
+        char line[0xff+1];
+        int lineNumber = 0;
+        bool ok = true;
+
+        while (ok && std::fgets(line, sizeof(line), file) != nullptr)
+        {
+            ++lineNumber;
+
+            if (char* const comment = std::strchr(line, '#'))
+                *comment = '\0';
+
+            line[std::strcspn(line, "\r\n")] = '\0';
+            ok = parseLine(line);
+
+            if (! ok)
+                std::fprintf(stderr, "JackAss: invalid parameter map line %i in '%s'\n", lineNumber, filename);
         }
 
-        pthread_mutex_unlock(&fMutex);
-    }
+        std::fclose(file);
 
-    void putEvent(const unsigned char data1, const unsigned char data2, const unsigned char data3, const unsigned char size, const VstInt32 time)
-    {
-        const unsigned char data[4] = { data1, data2, data3, 0 };
-        putEvent(data, size, time);
+        if (ok && count == 0)
+        {
+            std::fprintf(stderr, "JackAss: parameter map '%s' has no parameters\n", filename);
+            ok = false;
+        }
+
+        return ok;
     }
 
-    void jprocess(const jack_nframes_t nframes)
+    bool parseLine(char* str)
     {
-        void* const portBuffer(jackbridge_port_get_buffer(fPort, nframes));
-
-        if (portBuffer == nullptr)
-            return;
+        long newCC = -1, channel = 0, newValue = 0, newNumber = 0;
+        unsigned char newMode = kParamMode7Bit;
+        const char* newName = nullptr;
 
-        jackbridge_midi_clear_buffer(portBuffer);
+        for (;;)
+        {
+            str += std::strspn(str, " \t");
 
-        pthread_mutex_lock(&fMutex);
+            if (*str == '\0')
+                break;
 
-        for (int i=0; i < kMaxMidiEvents; ++i)
-        {
-            if (fData[i].data[0] == 0)
+            // the name takes the rest of the line
+            if (std::strncmp(str, "name=", 5) == 0)
+            {
+                newName = str+5;
                 break;
+            }
 
-            if (unsigned char* const buffer = jackbridge_midi_event_reserve(portBuffer, fData[i].time, fData[i].size))
-                std::memcpy(buffer, fData[i].data, fData[i].size);
+            char* const end(str + std::strcspn(str, " \t"));
+            const bool last(*end == '\0');
+            *end = '\0';
 
-            fData[i].data[0] = 0; // set as invalid
+            if (std::strncmp(str, "cc=", 3) == 0)
+                newCC = std::strtol(str+3, nullptr, 0);
+            else if (std::strncmp(str, "channel=", 8) == 0)
+                channel = std::strtol(str+8, nullptr, 0);
+            else if (std::strncmp(str, "default=", 8) == 0)
+                newValue = std::strtol(str+8, nullptr, 0);
+            else if (std::strncmp(str, "mode=", 5) != 0 || ! parseParamMode(str+5, newMode, newNumber))
+                return false;
+
+            if (last)
+                break;
+
+            str = end+1;
         }
 
-        pthread_mutex_unlock(&fMutex);
-    }
+        // empty or comment line
+        if (newCC == -1 && newName == nullptr)
+            return true;
 
-private:
-    jack_port_t*    fPort;
-    midi_data_t     fData[kMaxMidiEvents];
-    pthread_mutex_t fMutex;
-};
+        if (newCC < 0 || newCC > 127 || channel < 0 || channel > 16 || newValue < 0 || newValue > 127 || count == kMaxParams)
+            return false;
 
-// -------------------------------------------------
-// static list of JackAss instances
+        char defaultName[kParamNameLen];
 
-static std::list<JackAssInstance*> gInstances;
-static pthread_mutex_t gInstancesMutex = PTHREAD_MUTEX_INITIALIZER;
+        if (newName == nullptr || *newName == '\0')
+        {
+            std::snprintf(defaultName, kParamNameLen, "0x%02lX", newCC);
+            newName = defaultName;
+        }
 
-// -------------------------------------------------
-// JACK calls
+        add(int(newCC), int(channel)-1, float(newValue)/127.0f, newMode, newNumber, newName);
+        return true;
+    }
+};
 
-static int jprocess_callback(const jack_nframes_t nframes, void*)
+static const ParamMap gParamMap;
+static const int gParamCount(gParamMap.count);
+
+static inline
+float getParameterDefault(const int index) noexcept
 {
-    pthread_mutex_lock(&gInstancesMutex);
+    return gParamMap.value[index];
+}
 
-    for (std::list<JackAssInstance*>::iterator it = gInstances.begin(), end = gInstances.end(); it != end; ++it)
-        (*it)->jprocess(nframes);
+// parameters are kept with 14-bit resolution, 7-bit outputs use the upper 7 bits
+static inline
+uint16_t getParameterValue14(const float value) noexcept
+{
+    if (value <= 0.0f)
+        return 0;
+    if (value >= 1.0f)
+        return 0x3FFF;
 
-    pthread_mutex_unlock(&gInstancesMutex);
-    return 0;
+    return uint16_t(value*16383.0f);
 }
 
-static void jconnect_callback(const jack_port_id_t a, const jack_port_id_t b, const int connect_, void*)
+// 0.0 to 1.0, tested on the bits since -ffast-math lets the compiler assume there is no NaN.
+// Positive floats order like their bits, 1.0 is 0x3F800000, -0.0 is 0x80000000
+static inline
+bool isParameterValueValid(const float value) noexcept
 {
-    if (connect_ == 0)
-        return;
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
 
-    if (jackbridge_port_is_mine(gJackClient, jackbridge_port_by_id(gJackClient, a)) ||
-        jackbridge_port_is_mine(gJackClient, jackbridge_port_by_id(gJackClient, b)))
-        gNeedMidiResend = true;
+    return (bits <= 0x3F800000U || bits == 0x80000000U);
 }
 
-// -------------------------------------------------
-// JackAss plugin
-
-class JackAss : public AudioEffectX
+// what a receiver has after a reset, LSB at 0
+static inline
+uint16_t getParameterDefaultValue(const int index) noexcept
 {
-public:
-    JackAss(audioMasterCallback audioMaster)
-        : AudioEffectX(audioMaster, kProgramCount, kParamCount),
-          fInstance(nullptr)
-    {
-        for (int i=0; i < kParamCount; ++i)
-            fParamBuffers[i] = 0.0f;
+    return uint16_t(int(getParameterDefault(index)*127.0f) << 7);
+}
 
-        fParamBuffers[kParamVolume]  = 100.0f/127.0f;
-        fParamBuffers[kParamBalance] = 0.5f;
-        fParamBuffers[kParamPan]     = 0.5f;
+// channel and CC number to parameter index, -1 if not mapped
+struct ParamReverseMap {
+    signed char index[16][128];
 
-#ifdef USE_PROGRAMS
-        for (int i=0; i < kProgramCount; ++i)
+    ParamReverseMap()
+    {
+        std::memset(index, -1, sizeof(index));
+
+        // parameters on a given channel first, then the rest fill the gaps
+        for (int i=0; i < gParamCount; ++i)
         {
-            fProgramNames[i] = new char[kProgramNameSize+1];
-            std::snprintf(fProgramNames[i], kProgramNameSize, "Program #%i", i+1);
-            fProgramNames[i][kProgramNameSize] = '\0';
+            if (! gParamMap.anyChannel[i] && index[gParamMap.status[i] & 0x0F][gParamMap.cc[i]] < 0)
+                index[gParamMap.status[i] & 0x0F][gParamMap.cc[i]] = (signed char)i;
         }
-#endif
-
-        if (audioMaster == nullptr)
-            return;
-
-#ifdef JACKASS_SYNTH
-        isSynth();
-        setNumInputs(0);
-        setNumOutputs(2);
-        setUniqueID(CCONST('J', 'A', 's', 's'));
-#else
-        setNumInputs(2);
-        setNumOutputs(2);
-        setUniqueID(CCONST('J', 'A', 's', 'x'));
-#endif
-
-        char strBuf[0xff+1];
 
-        // Register global JACK client if needed
-        if (gJackClient == nullptr)
+        for (int i=0; i < gParamCount; ++i)
         {
-            std::memset(strBuf, 0, sizeof(char)*0xff+1);
+            if (! gParamMap.anyChannel[i])
+                continue;
 
-            if (getHostProductString(strBuf) && strBuf[0] != '\0')
-            {
-                char tmp[std::strlen(strBuf)+1];
-                std::strcpy(tmp, strBuf);
-#ifdef JACKASS_SYNTH
-                std::strcpy(strBuf, "JackAss-");
-#else
-                std::strcpy(strBuf, "JackAssFX-");
-#endif
-                std::strncat(strBuf, tmp, 0xff-11);
-                strBuf[0xff] = '\0';
-            }
-            else
+            for (int channel=0; channel < 16; ++channel)
             {
-#ifdef JACKASS_SYNTH
-                std::strcpy(strBuf, "JackAss");
-#else
-                std::strcpy(strBuf, "JackAssFX");
-#endif
+                if (index[channel][gParamMap.cc[i]] < 0)
+                    index[channel][gParamMap.cc[i]] = (signed char)i;
             }
+        }
+    }
+};
 
-            gJackClient = jackbridge_client_open(strBuf, JackNullOption, nullptr);
+static const ParamReverseMap gParamReverseMap;
 
-            if (gJackClient == nullptr)
-                return;
+// "<cc>=<value>,..." lists from the environment, the callback gets index -1 for "all"
+// and is called for every parameter on the CC, whatever their channel
+typedef void (*ParamListCallback)(void* ptr, int index, const char* value);
 
-            jackbridge_set_port_connect_callback(gJackClient, jconnect_callback, nullptr);
-            jackbridge_set_process_callback(gJackClient, jprocess_callback, nullptr);
-            jackbridge_activate(gJackClient);
-        }
+static void parseParamList(const char* const envName, const ParamListCallback callback, void* const ptr)
+{
+    const char* str(std::getenv(envName));
 
-        // Create instance + jack-port for this plugin
-        std::sprintf(strBuf, "midi-out_%02u", (int)gInstances.size() + 1);
+    while (str != nullptr && *str != '\0')
+    {
+        const bool all(std::strncmp(str, "all=", 4) == 0);
+        long cc = -1;
+        char* end = (char*)str+3;
 
-        if (jack_port_t* const jport = jackbridge_port_register(gJackClient, strBuf, JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0))
+        if (! all)
         {
-            fInstance = new JackAssInstance(jport);
+            cc = std::strtol(str, &end, 0);
 
-            pthread_mutex_lock(&gInstancesMutex);
-            gInstances.push_back(fInstance);
-            pthread_mutex_unlock(&gInstancesMutex);
+            if (end == str || cc < 0 || cc >= 128)
+                cc = -1;
         }
-    }
 
-    ~JackAss() override
-    {
-#ifdef USE_PROGRAMS
-        for (int i=0; i < kProgramCount; ++i)
+        int matches = 0;
+
+        if (*end == '=')
         {
-            if (fProgramNames[i] != nullptr)
+            if (all)
             {
-                delete[] fProgramNames[i];
-                fProgramNames[i] = nullptr;
+                callback(ptr, -1, end+1);
+                ++matches;
             }
-        }
-#endif
 
-        if (fInstance != nullptr)
-        {
-            pthread_mutex_lock(&gInstancesMutex);
-            gInstances.remove(fInstance);
-            pthread_mutex_unlock(&gInstancesMutex);
+            for (int i=0; i < gParamCount && cc >= 0; ++i)
+            {
+                if (gParamMap.cc[i] != cc)
+                    continue;
 
-            delete fInstance;
-            fInstance = nullptr;
+                callback(ptr, i, end+1);
+                ++matches;
+            }
         }
 
-        // Close global JACK client if needed
-        if (gJackClient != nullptr && gInstances.size() == 0)
+        if (matches == 0)
         {
-            jackbridge_deactivate(gJackClient);
-            jackbridge_client_close(gJackClient);
-            gJackClient = nullptr;
+            std::fprintf(stderr, "JackAss: invalid %s entry '%s'\n", envName, str);
+            return;
         }
+
+        if ((str = std::strchr(end, ',')) != nullptr)
+            ++str;
     }
+}
 
-    // ---------------------------------------------
+struct ParamModeMap {
+    unsigned char mode[kMaxParams];
+    uint16_t      number[kMaxParams]; // NRPN/RPN parameter number
 
-    void processReplacing(float** inputs, float** const outputs, const VstInt32 sampleFrames) override
+    // starts from the parameter map, JACKASS_PARAM_MODES overrides it
+    ParamModeMap()
     {
-#ifdef JACKASS_SYNTH
-        // Silent output
-        std::memset(outputs[0], 0, sizeof(float)*sampleFrames);
-        std::memset(outputs[1], 0, sizeof(float)*sampleFrames);
-#else
-        // Bypass
-        std::memcpy(outputs[0], inputs[0], sizeof(float)*sampleFrames);
-        std::memcpy(outputs[1], inputs[1], sizeof(float)*sampleFrames);
-#endif
+        for (int i=0; i < gParamCount; ++i)
+            set(i, gParamMap.mode[i], gParamMap.number[i]);
 
-        if (gNeedMidiResend && fInstance != nullptr)
-        {
-            for (int i=0; i < kParamCount; ++i)
-                fInstance->putEvent(0xB0, kParamMap[i], int(fParamBuffers[i]*127.0f), 3, 0);
+        parseParamList("JACKASS_PARAM_MODES", _parse, this);
+    }
 
-            gNeedMidiResend = false;
-        }
+    static void _parse(void* const ptr, const int index, const char* const str)
+    {
+        ParamModeMap* const self((ParamModeMap*)ptr);
 
-#ifdef JACKASS_SYNTH
-        return; // unused
-        (void)inputs;
-#endif
+        unsigned char newMode;
+        long newNumber;
+
+        // anything unknown is a plain CC
+        parseParamMode(str, newMode, newNumber);
+
+        if (index >= 0)
+            return self->set(index, newMode, newNumber);
+
+        // numbered modes get consecutive numbers
+        for (int i=0; i < gParamCount; ++i)
+            self->set(i, newMode, newNumber+i);
     }
 
-#ifdef JACKASS_SYNTH
-    VstInt32 processEvents(VstEvents* const events) override
+    void set(const int index, unsigned char newMode, const long newNumber)
     {
-        if (fInstance == nullptr || events == nullptr)
-            return 0; // FIXME?
+        // there is no LSB controller for CCs above 31
+        if (newMode == kParamMode14Bit && gParamMap.cc[index] >= 32)
+            newMode = kParamMode7Bit;
 
-        for (VstInt32 i=0; i < events->numEvents; ++i)
-        {
-            if (events->events[i] == nullptr)
-                break;
-            if (events->events[i]->type != kVstMidiType)
-                continue;
+        mode[index]   = newMode;
+        number[index] = uint16_t(newNumber & 0x3FFF);
+    }
+};
 
-            VstMidiEvent* const midiEvent((VstMidiEvent*)events->events[i]);
-            fInstance->putEvent(midiEvent->midiData[0], midiEvent->midiData[1], midiEvent->midiData[2], 3, midiEvent->deltaFrames);
-        }
+static const ParamModeMap gParamModeMap;
 
-        return 0;
-    }
-#endif
+// per parameter traffic limits, see JACKASS_PARAM_RATE and JACKASS_PARAM_THRESHOLD
+struct ParamLimitMap {
+    uint16_t rate[kMaxParams];      // max messages per second, 0 for no limit
+    uint16_t threshold[kMaxParams]; // min change in steps of the output resolution
 
-    // ---------------------------------------------
+    ParamLimitMap()
+    {
+        std::memset(rate, 0, sizeof(rate));
+        std::memset(threshold, 0, sizeof(threshold));
 
-#ifdef USE_PROGRAMS
-    void setProgram(const VstInt32 program) override
+        parseParamList("JACKASS_PARAM_RATE", _parse, rate);
+        parseParamList("JACKASS_PARAM_THRESHOLD", _parse, threshold);
+    }
+
+    static void _parse(void* const ptr, const int index, const char* const str)
     {
-        if (curProgram < 0 || curProgram >= kProgramCount)
-            return;
+        uint16_t* const values((uint16_t*)ptr);
+        const long value(std::strtol(str, nullptr, 0));
+        const uint16_t clamped((value > 0) ? uint16_t(value < 0x3FFF ? value : 0x3FFF) : 0);
 
-        if (fInstance != nullptr)
+        if (index >= 0)
+        {
+            values[index] = clamped;
+            return;
+        }
+
+        for (int i=0; i < gParamCount; ++i)
+            values[i] = clamped;
+    }
+};
+
+static const ParamLimitMap gParamLimitMap;
+
+// parameters with a CV output port, see JACKASS_CV_PORTS
+struct CvModeMap {
+    unsigned char mode[kMaxParams];
+    bool          enabled;
+
+    // mode is "linear" or "smooth"
+    CvModeMap()
+        : enabled(false)
+    {
+        std::memset(mode, kCvOff, sizeof(mode));
+
+        parseParamList("JACKASS_CV_PORTS", _parse, this);
+    }
+
+    static void _parse(void* const ptr, const int index, const char* const str)
+    {
+        CvModeMap* const self((CvModeMap*)ptr);
+        unsigned char newMode = kCvOff;
+
+        if (std::strncmp(str, "linear", 6) == 0)
+            newMode = kCvLinear;
+        else if (std::strncmp(str, "smooth", 6) == 0)
+            newMode = kCvSmooth;
+
+        if (newMode != kCvOff)
+            self->enabled = true;
+
+        if (index >= 0)
+        {
+            self->mode[index] = newMode;
+            return;
+        }
+
+        for (int i=0; i < gParamCount; ++i)
+            self->mode[i] = newMode;
+    }
+};
+
+static const CvModeMap gCvModeMap;
+
+#ifdef USE_PROGRAMS
+static const int kProgramCount = 128;
+#else
+static const int kProgramCount = 0;
+#endif
+
+// -------------------------------------------------
+// Data limits
+
+static const int kMaxMidiEvents   = 512;
+static const int kMaxResendEvents = 64; // per JACK cycle, for all instances
+static const int kMaxNoteOffEvents = 64; // per JACK cycle and instance, for released notes
+static const int kNoteWords        = 16*128/32; // active note bitmap, 1 bit per channel and note
+static const int kMinPartInstances = 32; // below this, extra process threads cost more than they save
+// (tests/BenchWorkers, 'make bench': handing a part to a helper costs ~4us, an instance with
+//  4 to 16 parameter changes per cycle 0.15 to 0.35us, so 2 parts pay off from ~25 busy instances)
+static const int kMaxMergeInstances = 16; // one per MIDI channel
+static const int kMaxSplitPorts     = 16; // one per MIDI channel
+static const int kAutomateInterval  = 10; // ms between host automation updates from midi-in
+static const int kParamSettleTime   = 20; // ms a parameter must be idle before a held back value is sent
+static const int kNoteOffTimeout    = 100; // ms to wait for note-offs to go out when closing
+static const int kExpiryRealtimeTime = 10;  // ms late before a queued clock or transport message is dropped
+static const int kExpiryNoteTime     = 50;  // ms late before a queued note-on is dropped
+static const int kExpiryOtherTime    = 500; // ms late before a queued CC or other message is dropped
+static const int kProgramNameSize = 32;
+
+// -------------------------------------------------
+// Midi data
+
+struct midi_data_t {
+    unsigned char data[4];
+    unsigned char size;
+    VstInt32 time;
+    jack_nframes_t stamp; // JACK frame time when queued
+
+    midi_data_t()
+        : size(0),
+          time(0),
+          stamp(0)
+    {
+        std::memset(data, 0, 4*sizeof(char));
+    }
+};
+
+// events from the optional midi-in port, stamped with JACK frame time
+struct midi_in_event_t {
+    jack_nframes_t frame;
+    unsigned char  size;
+    unsigned char  data[3];
+};
+
+// Queued events that JACK could not send in time (engine stall, xruns) are dropped
+// instead of going out late in a burst. Each kind has its own limit, note-offs never expire
+// as that would leave notes hanging.
+enum ExpiryClass {
+    kExpiryRealtime = 0, // clock, start/stop
+    kExpiryNote     = 1, // note-on
+    kExpiryOther    = 2, // CC and everything else
+    kExpiryClassCount,
+    kExpiryNever = kExpiryClassCount
+};
+
+static inline
+int getExpiryClass(const unsigned char data[4]) noexcept
+{
+    if (data[0] >= 0xF8)
+        return kExpiryRealtime;
+
+    switch (data[0] & 0xF0)
+    {
+    case 0x80:
+        return kExpiryNever;
+    case 0x90:
+        return (data[2] != 0) ? kExpiryNote : kExpiryNever;
+    default:
+        return kExpiryOther;
+    }
+}
+
+// ms per class, see JACKASS_EVENT_TTL, 0 means never
+struct ExpiryConfig {
+    uint32_t time[kExpiryClassCount];
+
+    // "realtime=<ms>,notes=<ms>,cc=<ms>"
+    ExpiryConfig()
+    {
+        time[kExpiryRealtime] = kExpiryRealtimeTime;
+        time[kExpiryNote]     = kExpiryNoteTime;
+        time[kExpiryOther]    = kExpiryOtherTime;
+
+        const char* str(std::getenv("JACKASS_EVENT_TTL"));
+
+        while (str != nullptr && *str != '\0')
+        {
+            int expiryClass = -1;
+
+            if (std::strncmp(str, "realtime=", 9) == 0)
+                expiryClass = kExpiryRealtime;
+            else if (std::strncmp(str, "notes=", 6) == 0)
+                expiryClass = kExpiryNote;
+            else if (std::strncmp(str, "cc=", 3) == 0)
+                expiryClass = kExpiryOther;
+
+            if (expiryClass < 0)
+            {
+                std::fprintf(stderr, "JackAss: invalid JACKASS_EVENT_TTL entry '%s'\n", str);
+                return;
+            }
+
+            const long value(std::strtol(std::strchr(str, '=')+1, nullptr, 0));
+            time[expiryClass] = (value > 0) ? uint32_t(value) : 0;
+
+            if ((str = std::strchr(str, ',')) != nullptr)
+                ++str;
+        }
+    }
+};
+
+static const ExpiryConfig gExpiryConfig;
+
+// -------------------------------------------------
+// Plugin state, as saved by the host through getChunk
+//
+// Header, then 'paramCount' parameters, then the port name and the ports it was connected
+// to as '\0' terminated strings, ending with an empty one. Native byte order.
+// Parameters are matched by CC and channel on restore, so a changed parameter map keeps
+// whatever still fits.
+
+static const char     kStateMagic[4] = { 'J', 'A', 's', 't' };
+static const uint32_t kStateVersion  = 1;
+
+struct state_header_t {
+    char     magic[4];
+    uint32_t version;
+    uint32_t paramCount;
+    uint32_t namesSize;
+};
+
+struct state_param_t {
+    unsigned char cc;
+    unsigned char status; // 0xB0 | channel
+    unsigned char reserved[2];
+    float         value;
+};
+
+// -------------------------------------------------
+// Global JACK client
+
+static jack_client_t* gJackClient    = nullptr;
+static volatile bool  gJackFreewheel = false;
+
+// where offline and freewheel renders are captured, nullptr when not enabled
+static const char* getCaptureDir()
+{
+#ifdef JACKASS_CAPTURE_UNSUPPORTED
+    return nullptr;
+#else
+    static const char* const captureDir(std::getenv("JACKASS_CAPTURE_DIR"));
+
+    return (captureDir != nullptr && captureDir[0] != '\0') ? captureDir : nullptr;
+#endif
+}
+
+// -------------------------------------------------
+// single JackAss instance, containing 1 MIDI port
+
+class JackAssInstance
+{
+    friend class JackAssMergeGroup;
+
+public:
+    // client is only set when the instance owns it (one JACK client per instance)
+    JackAssInstance(jack_port_t* const port, jack_client_t* const client = nullptr)
+        : fClient(client),
+          fPort(port),
+          fDataUsed(0),
+          fExpiryEnabled(false),
+          fConnected(false),
+          fWasConnected(false),
+          fResendPending(false),
+          fCapturing(false),
+          fTimelinePos(0),
+          fOutput(nullptr),
+          fShaper(nullptr),
+          fTransform(nullptr),
+          fCv(nullptr),
+          fChannel(-1),
+          fPortConnected(false),
+          fPortWasConnected(false),
+          fSplitEnabled(false),
+          fSplitQuit(false),
+          fInPort(nullptr),
+          fInHead(0),
+          fInTail(0),
+          fInBlockEnd(0),
+          fInParamsEnabled(false),
+          fAudioIsOutput(false),
+          fAudioHostBlock(0),
+          fParamLimited(false),
+          fParamHeldAny(false),
+          fParamSettle(0),
+          fNoteCount(0),
+          fNoteOffPending(false)
+    {
+        fAudioPorts[0] = fAudioPorts[1] = nullptr;
+
+        std::memset(fNotesOn, 0, sizeof(fNotesOn));
+        std::memset(fNotesOff, 0, sizeof(fNotesOff));
+        std::memset(fParamSelected, -1, sizeof(fParamSelected));
+
+        pthread_mutex_init(&fMutex, nullptr);
+
+        for (int i=0; i < kMaxSplitPorts; ++i)
+        {
+            fSplitPorts[i]        = nullptr;
+            fSplitConnected[i]    = false;
+            fSplitWasConnected[i] = false;
+            fSplitRequested[i]    = false;
+        }
+
+        for (int i=0; i < gParamCount; ++i)
+        {
+            fParamValues[i]  = getParameterDefaultValue(i);
+            fParamSent[i]    = kParamUnsent;
+            fParamChanged[i] = false;
+            fParamResend[i]  = false;
+
+            fInParamValues[i]  = 0;
+            fInParamPending[i] = false;
+        }
+
+        initParamLimits();
+        initExpiry();
+
+        if (getCaptureDir() != nullptr)
+            fCapture.start();
+    }
+
+    ~JackAssInstance()
+    {
+        if (fClient != nullptr)
+            jackbridge_deactivate(fClient);
+
+        if (fSplitEnabled)
+        {
+            fSplitQuit = true;
+            fSplitWake.post();
+            pthread_join(fSplitThread, nullptr);
+        }
+
+        fCapture.stop();
+        pthread_mutex_destroy(&fMutex);
+
+        if (fAudioRing.getOverruns() != 0 || fAudioRing.getUnderruns() != 0)
+            std::fprintf(stderr, "JackAss: audio ring had %u overruns and %u underruns\n",
+                         fAudioRing.getOverruns(), fAudioRing.getUnderruns());
+
+        for (int i=0; i < gParamCount; ++i)
+        {
+            if (fParamSuppressed[i] != 0)
+                std::fprintf(stderr, "JackAss: CC 0x%02X had %u messages suppressed by rate limit or threshold\n",
+                             gParamMap.cc[i], fParamSuppressed[i]);
+        }
+
+        if (fExpired[kExpiryRealtime] != 0 || fExpired[kExpiryNote] != 0 || fExpired[kExpiryOther] != 0)
+            std::fprintf(stderr, "JackAss: dropped late events, %u realtime, %u notes, %u other\n",
+                         fExpired[kExpiryRealtime], fExpired[kExpiryNote], fExpired[kExpiryOther]);
+
+        if (fPort != nullptr)
+        {
+            if (jack_client_t* const client = getClient())
+            {
+                for (int i=0; i < kMaxSplitPorts; ++i)
+                {
+                    if (fSplitPorts[i] != nullptr)
+                        jackbridge_port_unregister(client, fSplitPorts[i]);
+                }
+
+                if (fInPort != nullptr)
+                    jackbridge_port_unregister(client, fInPort);
+
+                for (int i=0; i < 2; ++i)
+                {
+                    if (fAudioPorts[i] != nullptr)
+                        jackbridge_port_unregister(client, fAudioPorts[i]);
+                }
+
+                if (fCv != nullptr)
+                    fCv->unregisterPorts(client);
+
+                jackbridge_port_unregister(client, fPort);
+            }
+
+            fPort = nullptr;
+        }
+
+        if (fClient != nullptr)
+        {
+            jackbridge_client_close(fClient);
+            fClient = nullptr;
+        }
+
+        if (fOutput != nullptr)
+        {
+            delete fOutput;
+            fOutput = nullptr;
+        }
+
+        if (fShaper != nullptr)
+        {
+            printShaperStats(fShaper);
+            delete fShaper;
+            fShaper = nullptr;
+        }
+
+        if (fTransform != nullptr)
+        {
+            delete fTransform;
+            fTransform = nullptr;
+        }
+
+        if (fCv != nullptr)
+        {
+            delete fCv;
+            fCv = nullptr;
+        }
+    }
+
+    // hub mode, events go to a port of the JackAss hub process instead of our own
+    bool openHub(const char* const portName, const char* const shmName)
+    {
+        JackAssHubSlot* const hub(new JackAssHubSlot());
+
+        if (! hub->open(portName, shmName))
+        {
+            delete hub;
+            return false;
+        }
+
+        fOutput = hub;
+        return true;
+    }
+
+    // shared memory mode, events go to a ring read by a non-JACK process
+    bool openShm(const char* const name, const uint32_t sampleRate)
+    {
+        JackAssShmOutput* const shm(new JackAssShmOutput());
+
+        if (! shm->open(name, sampleRate))
+        {
+            delete shm;
+            return false;
+        }
+
+        fOutput = shm;
+        return true;
+    }
+
+    bool hasOutput() const noexcept
+    {
+        return (fOutput != nullptr);
+    }
+
+    bool hasOwnClient() const noexcept
+    {
+        return (fClient != nullptr);
+    }
+
+    jack_client_t* getClient() const noexcept
+    {
+        return (fClient != nullptr) ? fClient : gJackClient;
+    }
+
+    jack_port_t* getPort() const noexcept
+    {
+        return fPort;
+    }
+
+    // split mode, channel messages go to per-channel ports, registered by a helper thread
+    // the first time a channel is used. Until then they go to the main port.
+    bool startSplit()
+    {
+        if (fPort == nullptr || fSplitEnabled)
+            return false;
+
+        fSplitQuit = false;
+
+        if (pthread_create(&fSplitThread, nullptr, _splitThread, this) != 0)
+            return false;
+
+        fSplitEnabled = true;
+        return true;
+    }
+
+    // takes ownership, must be set before any events are queued
+    void setTransform(JackAssTransform* const transform) noexcept
+    {
+        fTransform = transform;
+    }
+
+    // takes ownership, must be set before the instance is processed
+    void setCv(JackAssCv* const cv) noexcept
+    {
+        fCv = cv;
+    }
+
+    uint16_t getParameterValue(const int index) const noexcept
+    {
+        return fParamValues[index];
+    }
+
+    // DIN bandwidth shaping of the main port, not used in split mode
+    void enableShaper()
+    {
+        if (fPort == nullptr || fSplitEnabled || fShaper != nullptr)
+            return;
+
+        fShaper = new JackAssDinShaper(jackbridge_get_sample_rate(getClient()));
+    }
+
+    static void printShaperStats(const JackAssDinShaper* const shaper)
+    {
+        if (shaper->getMaxNoteDelay() == 0 && shaper->getDropped() == 0)
+            return;
+
+        std::fprintf(stderr, "JackAss: DIN shaping delayed notes by up to %u frames and dropped %u events\n",
+                     shaper->getMaxNoteDelay(), shaper->getDropped());
+    }
+
+    // optional midi-in port, its events are handed to the host from processReplacing
+    void setInputPort(jack_port_t* const port) noexcept
+    {
+        fInPort = port;
+    }
+
+    bool hasInputPort() const noexcept
+    {
+        return (fInPort != nullptr);
+    }
+
+    // optional stereo audio ports, outputs (send) or inputs (return)
+    void setAudioPorts(jack_port_t* const port1, jack_port_t* const port2, const bool isOutput) noexcept
+    {
+        fAudioPorts[0] = port1;
+        fAudioPorts[1] = port2;
+        fAudioIsOutput = isOutput;
+    }
+
+    bool hasAudioPorts() const noexcept
+    {
+        return (fAudioPorts[0] != nullptr);
+    }
+
+    // called when the host (re)starts processing, returns the latency of the audio ring
+    uint32_t initAudio(const uint32_t hostBlockSize)
+    {
+        const uint32_t jackBufferSize(jackbridge_get_buffer_size(getClient()));
+        const uint32_t maxBlock((hostBlockSize > jackBufferSize) ? hostBlockSize : jackBufferSize);
+
+        pthread_mutex_lock(&fMutex);
+        fAudioHostBlock = hostBlockSize;
+        fAudioRing.init(hostBlockSize + jackBufferSize, maxBlock);
+        pthread_mutex_unlock(&fMutex);
+
+        return fAudioRing.getLatency();
+    }
+
+    // JACK period changed, the ring keeps its memory and drifts to the new latency.
+    // The latency reported to the host follows on the next resume.
+    void setAudioBufferSize(const jack_nframes_t nframes)
+    {
+        if (fAudioPorts[0] == nullptr)
+            return;
+
+        pthread_mutex_lock(&fMutex);
+        fAudioRing.setTarget(fAudioHostBlock + nframes);
+        pthread_mutex_unlock(&fMutex);
+    }
+
+    // host side of the audio ring
+    void putAudio(const float* const left, const float* const right, const VstInt32 sampleFrames)
+    {
+        fAudioRing.write(left, right, uint32_t(sampleFrames));
+    }
+
+    void getAudio(float* const left, float* const right, const VstInt32 sampleFrames, const float gain)
+    {
+        fAudioRing.read(left, right, uint32_t(sampleFrames), gain);
+    }
+
+    // midi-in CCs matching a parameter are taken as parameter changes instead of MIDI
+    void enableInputParams() noexcept
+    {
+        fInParamsEnabled = true;
+    }
+
+    // blocks until a parameter arrives on midi-in (or wakeInputParams is called)
+    void waitInputParams()
+    {
+        fInParamWake.wait();
+    }
+
+    void wakeInputParams()
+    {
+        fInParamWake.post();
+    }
+
+    // latest value only, anything received in between is dropped
+    bool takeInputParam(const int index, unsigned char& value)
+    {
+        if (! fInParamPending[index])
+            return false;
+
+        fInParamPending[index] = false;
+        __sync_synchronize();
+        value = fInParamValues[index];
+        return true;
+    }
+
+    // called from the host audio thread, takes the input events that belong to the current block
+    uint32_t getInputEvents(VstMidiEvent* const events, const uint32_t maxCount, const VstInt32 sampleFrames)
+    {
+        if (fInPort == nullptr)
+            return 0;
+
+        jack_client_t* const client(getClient());
+
+        // events were captured during the previous JACK period, play them back one period later
+        const jack_nframes_t bufferSize(jackbridge_get_buffer_size(client));
+        jack_nframes_t blockStart(jackbridge_frame_time(client) - bufferSize);
+
+        // host blocks are contiguous, unless it fell behind by more than a few periods
+        const int32_t overlap(int32_t(fInBlockEnd - blockStart));
+
+        if (overlap > 0 && overlap < int32_t(bufferSize*4))
+            blockStart = fInBlockEnd;
+
+        fInBlockEnd = blockStart + jack_nframes_t(sampleFrames);
+
+        const uint32_t head(fInHead);
+        __sync_synchronize();
+
+        uint32_t tail(fInTail), count = 0;
+
+        for (; tail != head && count < maxCount; ++tail)
+        {
+            const midi_in_event_t& inEvent(fInEvents[tail & (kMaxMidiEvents-1)]);
+            const int32_t offset(int32_t(inEvent.frame - blockStart));
+
+            // belongs to a later block
+            if (offset >= sampleFrames)
+                break;
+
+            VstMidiEvent& event(events[count++]);
+            std::memset(&event, 0, sizeof(VstMidiEvent));
+            event.type        = kVstMidiType;
+            event.byteSize    = sizeof(VstMidiEvent);
+            event.deltaFrames = (offset > 0) ? offset : 0;
+            event.flags       = kVstMidiEventIsRealtime;
+            std::memcpy(event.midiData, inEvent.data, inEvent.size);
+        }
+
+        __sync_synchronize();
+        fInTail = tail;
+
+        return count;
+    }
+
+    bool ownsPort(const jack_port_t* const port) const noexcept
+    {
+        if (port == nullptr)
+            return false;
+        if (port == fPort)
+            return true;
+
+        for (int i=0; i < kMaxSplitPorts; ++i)
+        {
+            if (fSplitPorts[i] == port)
+                return true;
+        }
+
+        return false;
+    }
+
+    // called from the JACK notification thread when one of our ports gets (dis)connected
+    void updateConnections(const bool newConnection)
+    {
+        // a port can have several connections, only go idle when the last one is gone
+        fPortConnected = jackbridge_port_connected(fPort);
+
+        bool connected = fPortConnected;
+
+        for (int i=0; i < kMaxSplitPorts; ++i)
+        {
+            if (fSplitPorts[i] == nullptr)
+                continue;
+
+            fSplitConnected[i] = jackbridge_port_connected(fSplitPorts[i]);
+            connected = connected || fSplitConnected[i];
+        }
+
+        setConnected(connected, newConnection);
+    }
+
+    // merge mode, every channel message gets rewritten to this channel
+    void setChannel(const int channel) noexcept
+    {
+        fChannel = channel;
+    }
+
+    // called from the JACK notification thread when our port gets (dis)connected
+    void setConnected(const bool connected, const bool newConnection)
+    {
+        if (fConnected == connected && ! newConnection)
+            return;
+
+        pthread_mutex_lock(&fMutex);
+
+        if (fConnected != connected)
+        {
+            // whatever was queued belongs to the previous connection state
+            for (int i=0; i < kMaxMidiEvents; ++i)
+                fData[i].data[0] = 0;
+
+            if (fShaper != nullptr)
+                fShaper->reset();
+
+            // and so are the notes it holds
+            std::memset(fNotesOn, 0, sizeof(fNotesOn));
+            std::memset(fNotesOff, 0, sizeof(fNotesOff));
+            fNoteCount      = 0;
+            fNoteOffPending = false;
+
+            fConnected = connected;
+        }
+
+        // refresh the new receiver, skipping controllers it should already have at default
+        if (connected && newConnection)
+        {
+            bool needsResend = false;
+
+            for (int i=0; i < gParamCount; ++i)
+            {
+                fParamResend[i] = fParamChanged[i] || fParamValues[i] != getParameterDefaultValue(i);
+                needsResend = needsResend || fParamResend[i];
+            }
+
+            fResendPending = needsResend;
+        }
+        else if (! connected)
+        {
+            fResendPending = false;
+        }
+
+        pthread_mutex_unlock(&fMutex);
+    }
+
+    // value is 14-bit, sendEvent is false for values that came in through midi-in,
+    // time is the offset in the current host block
+    void setParameter(const int index, const uint16_t value, const bool sendEvent = true, const VstInt32 time = 0)
+    {
+        unsigned char msgs[kParamMaxMessages][3];
+        uint32_t msgCount = 0;
+
+        pthread_mutex_lock(&fMutex);
+        fParamValues[index]  = value;
+        fParamChanged[index] = true;
+
+        if (fCv != nullptr)
+            fCv->setValue(index, float(value) / 16383.0f);
+
+        // the hub only knows about plain controllers
+        if (fOutput != nullptr && gParamModeMap.mode[index] <= kParamMode14Bit)
+            setOutputController(index, value);
+
+        if (sendEvent && ! (fParamLimited && holdParameter(index)))
+            msgCount = encodeParameter(index, false, msgs);
+
+        pthread_mutex_unlock(&fMutex);
+
+        for (uint32_t i=0; i < msgCount; ++i)
+            putEvent(msgs[i][0], msgs[i][1], msgs[i][2], 3, time);
+    }
+
+    // project load, sets all parameters without sending anything. A connected receiver gets the
+    // ones it does not have yet in one resend, otherwise they go out when the port gets connected.
+    void restoreParameters(const uint16_t values[kMaxParams])
+    {
+        bool needsResend = false;
+
+        pthread_mutex_lock(&fMutex);
+
+        for (int i=0; i < gParamCount; ++i)
+        {
+            if (values[i] == kParamUnsent)
+                continue;
+
+            fParamChanged[i] = fParamChanged[i] || fParamValues[i] != values[i];
+            fParamValues[i]  = values[i];
+            fParamHeld[i]    = false;
+
+            if (fCv != nullptr)
+                fCv->setValue(i, float(values[i]) / 16383.0f);
+
+            if (fOutput != nullptr && gParamModeMap.mode[i] <= kParamMode14Bit)
+                setOutputController(i, values[i]);
+
+            if (fConnected && ! isParameterSent(i))
+            {
+                fParamResend[i] = true;
+                needsResend = true;
+            }
+        }
+
+        if (needsResend)
+            fResendPending = true;
+
+        pthread_mutex_unlock(&fMutex);
+    }
+
+    // offline/freewheel render, events go to a capture file stamped with the host timeline
+    bool isCapturing() const noexcept
+    {
+        return fCapturing;
+    }
+
+    bool startCapture(const char* const filename, const uint32_t sampleRate, const uint64_t position)
+    {
+        pthread_mutex_lock(&fMutex);
+
+        // drop real-time events that did not make it out yet
+        for (int i=0; i < kMaxMidiEvents; ++i)
+            fData[i].data[0] = 0;
+
+        // the capture helper thread opens the file, events wait for it in memory
+        fCapturing  = fCapture.requestOpen(filename, sampleRate);
+        fTimelinePos = position;
+
+        pthread_mutex_unlock(&fMutex);
+        return fCapturing;
+    }
+
+    void stopCapture()
+    {
+        pthread_mutex_lock(&fMutex);
+        fCapturing = false;
+        fCapture.requestClose();
+        pthread_mutex_unlock(&fMutex);
+    }
+
+    // host timeline position of the current block, events are relative to it
+    void setTimelinePosition(const uint64_t position) noexcept
+    {
+        fTimelinePos = position;
+    }
+
+    void putEvent(const unsigned char dataIn[4], const unsigned char size, const VstInt32 time)
+    {
+        unsigned char data[4] = { dataIn[0], dataIn[1], dataIn[2], dataIn[3] };
+
+        // filtered events never reach the queue
+        if (! prepareEvent(data))
+            return;
+
+        // first use of a channel, ask for its port
+        if (fSplitEnabled && data[0] >= 0x80 && data[0] < 0xF0 && ! fSplitRequested[data[0] & 0x0F])
+        {
+            fSplitRequested[data[0] & 0x0F] = true;
+            fSplitWake.post();
+        }
+
+        if (fCapturing)
+        {
+            pthread_mutex_lock(&fMutex);
+
+            if (fCapturing)
+                fCapture.write(fTimelinePos + uint64_t(time), data, size);
+
+            pthread_mutex_unlock(&fMutex);
+            return;
+        }
+
+        if (fOutput != nullptr)
+        {
+            if (! fOutput->isConnected())
+                return;
+
+            const uint32_t blockTime(time > 0 ? uint32_t(time) : 0);
+
+            pthread_mutex_lock(&fMutex);
+            fOutput->write(data, size, blockTime, fTimelinePos + blockTime);
+            pthread_mutex_unlock(&fMutex);
+            return;
+        }
+
+        // nobody is listening, don't bother queueing
+        if (! fConnected)
+            return;
+
+        pthread_mutex_lock(&fMutex);
+
+        if (fConnected)
+        {
+            trackNote(data);
+            queueEvent(data, size, time);
+        }
+
+        pthread_mutex_unlock(&fMutex);
+    }
+
+    // transform and merge channel, for everything that goes out. Returns false if filtered out
+    bool prepareEvent(unsigned char data[4]) const noexcept
+    {
+        if (fTransform != nullptr && ! fTransform->process(data))
+            return false;
+
+        if (fChannel >= 0 && data[0] >= 0x80 && data[0] < 0xF0)
+            data[0] = (unsigned char)((data[0] & 0xF0) | fChannel);
+
+        return true;
+    }
+
+    bool hasActiveNotes() const noexcept
+    {
+        return (fNoteCount != 0);
+    }
+
+    bool hasNoteOffsPending() const noexcept
+    {
+        return fNoteOffPending;
+    }
+
+    // note-offs for every note still held by the receiver, sent by the JACK thread after
+    // the events already queued, a few at a time
+    void releaseNotes()
+    {
+        if (fNoteCount == 0)
+            return;
+
+        pthread_mutex_lock(&fMutex);
+
+        for (int i=0; i < kNoteWords; ++i)
+        {
+            fNotesOff[i] |= fNotesOn[i];
+            fNotesOn[i]   = 0;
+        }
+
+        fNoteCount      = 0;
+        fNoteOffPending = true;
+
+        pthread_mutex_unlock(&fMutex);
+    }
+
+    void putEvent(const unsigned char data1, const unsigned char data2, const unsigned char data3, const unsigned char size, const VstInt32 time)
+    {
+        const unsigned char data[4] = { data1, data2, data3, 0 };
+        putEvent(data, size, time);
+    }
+
+    void jprocess(const jack_nframes_t nframes, int& resendBudget)
+    {
+        if (fInPort != nullptr)
+            jprocessInput(nframes);
+
+        if (fAudioPorts[0] != nullptr)
+            jprocessAudio(nframes);
+
+        if (fCv != nullptr)
+            fCv->process(nframes);
+
+        // idle mode, the port buffer is not read by anyone
+        if (! fConnected)
+        {
+            if (fWasConnected)
+                jprocessIdle(nframes);
+            return;
+        }
+
+        fWasConnected = true;
+
+        if (fSplitEnabled)
+            return jprocessSplit(nframes, resendBudget);
+
+        void* const portBuffer(getPortBuffer(fPort, true, fPortWasConnected, nframes));
+
+        if (portBuffer == nullptr)
+            return;
+
+        pthread_mutex_lock(&fMutex);
+
+        // state refresh goes first, queued events are newer
+        if (fResendPending)
+            jprocessResend(portBuffer, resendBudget, fShaper);
+
+        const uint32_t eventCount(jprocessSort(nframes));
+
+        if (fShaper != nullptr)
+        {
+            for (uint32_t i=0; i < eventCount; ++i)
+                fShaper->put(fEvents[i].buffer, fEvents[i].size, fEvents[i].time);
+        }
+        else
+        {
+            jackbridge_midi_events_write(portBuffer, fEvents, eventCount);
+        }
+
+        if (fNoteOffPending)
+            jprocessNoteOffs(&portBuffer, fShaper, nframes);
+
+        if (fShaper != nullptr)
+            fShaper->write(portBuffer, nframes);
+
+        jprocessClear();
+
+        pthread_mutex_unlock(&fMutex);
+    }
+
+private:
+    jack_client_t*  fClient;
+    jack_port_t*    fPort;
+    midi_data_t     fData[kMaxMidiEvents];
+    pthread_mutex_t fMutex;
+
+    // sorted view of fData, written to the port in one go
+    jack_midi_event_t fEvents[kMaxMidiEvents];
+    uint32_t          fDataUsed; // slots looked at by jprocessSort, cleared by jprocessClear
+
+    // late event expiry, see ExpiryConfig
+    bool           fExpiryEnabled;
+    jack_nframes_t fExpiryFrames[kExpiryClassCount];
+    uint32_t       fExpired[kExpiryClassCount];
+
+    volatile bool fConnected;
+    bool          fWasConnected; // JACK thread only, some port buffer may still hold events
+    bool          fResendPending;
+
+    JackAssCapture fCapture;
+    volatile bool  fCapturing;
+    uint64_t       fTimelinePos;
+
+    // hub or shared memory output, instead of the JACK port
+    JackAssOutput*  fOutput;
+    JackAssDinShaper* fShaper; // only reset with fMutex locked
+    JackAssTransform* fTransform;
+    JackAssCv*        fCv;    // parameter CV outputs, JACK ports only
+    int             fChannel; // merge mode channel, -1 otherwise
+
+    // split mode, fSplitPorts are only written once by the helper thread
+    volatile bool         fPortConnected;
+    bool                  fPortWasConnected; // JACK thread only, like fSplitWasConnected
+    jack_port_t* volatile fSplitPorts[kMaxSplitPorts];
+    volatile bool         fSplitConnected[kMaxSplitPorts];
+    bool                  fSplitWasConnected[kMaxSplitPorts];
+    volatile bool         fSplitRequested[kMaxSplitPorts];
+    bool                  fSplitEnabled;
+    volatile bool         fSplitQuit;
+    pthread_t             fSplitThread;
+    JackAssSemaphore      fSplitWake;
+
+    // midi-in, single producer (JACK thread) and single consumer (host audio thread)
+    jack_port_t*      fInPort;
+    midi_in_event_t   fInEvents[kMaxMidiEvents];
+    volatile uint32_t fInHead;
+    volatile uint32_t fInTail;
+    jack_nframes_t    fInBlockEnd; // JACK time of the end of the last host block
+
+    // midi-in parameter changes, written by the JACK thread
+    bool                   fInParamsEnabled;
+    volatile unsigned char fInParamValues[kMaxParams];
+    volatile bool          fInParamPending[kMaxParams];
+    JackAssSemaphore       fInParamWake;
+
+    // audio ports, the ring is only reset with fMutex locked
+    jack_port_t*     fAudioPorts[2];
+    bool             fAudioIsOutput;
+    uint32_t         fAudioHostBlock;
+    JackAssAudioRing fAudioRing;
+
+    uint16_t fParamValues[kMaxParams];
+    uint16_t fParamSent[kMaxParams];         // last value queued, or kParamUnsent
+    bool     fParamChanged[kMaxParams];      // since last full send
+    bool     fParamResend[kMaxParams];
+    int      fParamSelected[16];              // current NRPN (0x4000 | number) or RPN per channel, -1 if none
+
+    // rate limit and threshold, times are JACK frames. Values held back are sent
+    // from the JACK thread once the parameter settles
+    bool           fParamLimited;
+    bool           fParamHeldAny;
+    bool           fParamHeld[kMaxParams];
+    jack_nframes_t fParamInterval[kMaxParams];  // min frames between messages
+    uint16_t       fParamThreshold[kMaxParams]; // min change of the 14-bit value
+    jack_nframes_t fParamSentTime[kMaxParams];
+    jack_nframes_t fParamChangeTime[kMaxParams];
+    jack_nframes_t fParamSettle;
+    uint32_t       fParamSuppressed[kMaxParams];
+
+    void initParamLimits()
+    {
+        jack_client_t* const client(getClient());
+        const jack_nframes_t sampleRate((client != nullptr) ? jackbridge_get_sample_rate(client) : 0);
+
+        for (int i=0; i < gParamCount; ++i)
+        {
+            const uint16_t rate(gParamLimitMap.rate[i]);
+            const uint16_t threshold(gParamLimitMap.threshold[i]);
+
+            fParamHeld[i]       = false;
+            fParamInterval[i]   = (rate != 0) ? sampleRate / rate : 0;
+            fParamThreshold[i]  = (gParamModeMap.mode[i] == kParamMode7Bit) ? uint16_t(threshold << 7) : threshold;
+            fParamSentTime[i]   = 0;
+            fParamChangeTime[i] = 0;
+            fParamSuppressed[i] = 0;
+
+            // only our own JACK port has a clock
+            if (sampleRate != 0 && (fParamInterval[i] != 0 || fParamThreshold[i] != 0))
+                fParamLimited = true;
+        }
+
+        fParamSettle = sampleRate * kParamSettleTime / 1000;
+    }
+
+    void initExpiry()
+    {
+        jack_client_t* const client(getClient());
+        const jack_nframes_t sampleRate((client != nullptr) ? jackbridge_get_sample_rate(client) : 0);
+
+        fExpiryEnabled = false;
+
+        for (int i=0; i < kExpiryClassCount; ++i)
+        {
+            fExpiryFrames[i] = jack_nframes_t(uint64_t(sampleRate) * gExpiryConfig.time[i] / 1000);
+            fExpired[i]      = 0;
+
+            if (fExpiryFrames[i] != 0)
+                fExpiryEnabled = true;
+        }
+    }
+
+    // must be called with fMutex locked, true if the event waited too long to be worth sending.
+    // One period of waiting is normal, events queued during a cycle go out in the next one.
+    bool expireEvent(const midi_data_t& event, const jack_nframes_t now, const jack_nframes_t nframes)
+    {
+        const int expiryClass(getExpiryClass(event.data));
+
+        if (expiryClass == kExpiryNever || fExpiryFrames[expiryClass] == 0)
+            return false;
+
+        if (int32_t(now - event.stamp) <= int32_t(nframes + fExpiryFrames[expiryClass]))
+            return false;
+
+        ++fExpired[expiryClass];
+
+        // the receiver still needs the current value of a parameter, send it again in full
+        if ((event.data[0] & 0xF0) == 0xB0)
+        {
+            const int index(gParamReverseMap.index[event.data[0] & 0x0F][event.data[1] & 0x7F]);
+
+            if (index >= 0 && gParamModeMap.mode[index] <= kParamMode14Bit)
+            {
+                fParamResend[index] = true;
+                fResendPending = true;
+            }
+        }
+
+        return true;
+    }
+
+    // must be called with fMutex locked, after the events sorted by jprocessSort were written
+    void jprocessClear()
+    {
+        for (uint32_t i=0; i < fDataUsed; ++i)
+            fData[i].data[0] = 0; // set as invalid
+
+        fDataUsed = 0;
+    }
+
+    // must be called with fMutex locked, returns true if the new value is held back for now
+    bool holdParameter(const int index)
+    {
+        if (fOutput != nullptr || (fParamInterval[index] == 0 && fParamThreshold[index] == 0))
+            return false;
+
+        const jack_nframes_t now(jackbridge_frame_time(getClient()));
+        bool hold = false;
+
+        fParamChangeTime[index] = now;
+
+        if (fParamSent[index] != kParamUnsent)
+        {
+            const int diff(int(fParamValues[index]) - int(fParamSent[index]));
+
+            hold = int32_t(now - fParamSentTime[index]) < int32_t(fParamInterval[index]) ||
+                   (diff < fParamThreshold[index] && -diff < fParamThreshold[index]);
+        }
+
+        if (hold)
+        {
+            fParamHeld[index] = true;
+            fParamHeldAny     = true;
+            ++fParamSuppressed[index];
+            return true;
+        }
+
+        fParamHeld[index]     = false;
+        fParamSentTime[index] = now;
+        return false;
+    }
+
+    bool isParameterSent(const int index) const noexcept
+    {
+        if (gParamModeMap.mode[index] == kParamMode7Bit)
+            return (fParamSent[index] >> 7) == (fParamValues[index] >> 7);
+
+        return fParamSent[index] == fParamValues[index];
+    }
+
+    // must be called with fMutex locked, sends the final values of bursts that ended
+    void jprocessHeld()
+    {
+        const jack_nframes_t now(jackbridge_last_frame_time(getClient()));
+
+        unsigned char msgs[kParamMaxMessages][3];
+        bool heldAny = false;
+
+        for (int i=0; i < gParamCount; ++i)
+        {
+            if (! fParamHeld[i])
+                continue;
+
+            if (int32_t(now - fParamChangeTime[i]) < int32_t(fParamSettle) ||
+                int32_t(now - fParamSentTime[i]) < int32_t(fParamInterval[i]))
+            {
+                heldAny = true;
+                continue;
+            }
+
+            fParamHeld[i] = false;
+
+            // nothing the receiver would notice
+            if (isParameterSent(i))
+                continue;
+
+            const uint32_t msgCount(encodeParameter(i, false, msgs));
+
+            for (uint32_t j=0; j < msgCount; ++j)
+            {
+                unsigned char data[4] = { msgs[j][0], msgs[j][1], msgs[j][2], 0 };
+
+                if (prepareEvent(data))
+                    queueEvent(data, 3, 0);
+            }
+
+            fParamSentTime[i] = now;
+            --fParamSuppressed[i];
+        }
+
+        fParamHeldAny = heldAny;
+    }
+
+    // active notes, updated as events are queued. Released notes wait in fNotesOff for the JACK thread
+    uint32_t      fNotesOn[kNoteWords];
+    uint32_t      fNotesOff[kNoteWords];
+    volatile int  fNoteCount;
+    volatile bool fNoteOffPending;
+
+    // must be called with fMutex locked
+    void trackNote(const unsigned char data[4])
+    {
+        const unsigned char type(data[0] & 0xF0);
+
+        if (type != 0x80 && type != 0x90)
+            return;
+
+        const int      index(((data[0] & 0x0F) << 7) | (data[1] & 0x7F));
+        const uint32_t bit(1U << (index & 31));
+        uint32_t&      word(fNotesOn[index >> 5]);
+
+        if (type == 0x90 && data[2] != 0)
+        {
+            if ((word & bit) == 0)
+                ++fNoteCount;
+
+            word |= bit;
+
+            // played again after a release, the note-off would cut it
+            fNotesOff[index >> 5] &= ~bit;
+        }
+        else if ((word & bit) != 0)
+        {
+            word &= ~bit;
+            --fNoteCount;
+        }
+    }
+
+    // must be called with fMutex locked, after the queued events of the cycle.
+    // In split mode portBuffers has one buffer per channel plus the main one, otherwise just one
+    void jprocessNoteOffs(void* const* const portBuffers, JackAssDinShaper* const shaper, const jack_nframes_t nframes)
+    {
+        int count = 0;
+
+        for (int i=0; i < kNoteWords; ++i)
+        {
+            while (fNotesOff[i] != 0)
+            {
+                // out of room for this cycle, continue on the next one
+                if (count++ == kMaxNoteOffEvents)
+                    return;
+
+                const int bit(__builtin_ctz(fNotesOff[i]));
+                const int index((i << 5) | bit);
+                const unsigned char data[3] = { (unsigned char)(0x80 | (index >> 7)), (unsigned char)(index & 0x7F), 0 };
+
+                fNotesOff[i] &= fNotesOff[i] - 1;
+
+                void* const portBuffer(portBuffers[fSplitEnabled ? getSplitIndex(data[0]) : 0]);
+
+                if (shaper != nullptr)
+                    shaper->put(data, 3, nframes-1);
+                else if (portBuffer != nullptr)
+                    jackbridge_midi_event_write(portBuffer, nframes-1, data, 3);
+            }
+        }
+
+        fNoteOffPending = false;
+    }
+
+    // must be called with fMutex locked, the MSB as the output would send it
+    void setOutputController(const int index, const uint16_t value)
+    {
+        unsigned char data[4] = { gParamMap.status[index], gParamMap.cc[index], (unsigned char)(value >> 7), 0 };
+
+        if (prepareEvent(data))
+            fOutput->setController(data[0], data[1], data[2], true);
+    }
+
+    // must be called with fMutex locked, dropped if the queue is full
+    void queueEvent(const unsigned char* const data, const unsigned char size, const VstInt32 time)
+    {
+        for (int i=0; i < kMaxMidiEvents; ++i)
+        {
+            if (fData[i].data[0] != 0)
+                continue;
+
+            std::memset(fData[i].data, 0, 4);
+            std::memcpy(fData[i].data, data, (size < 4) ? size : 4);
+            fData[i].size  = size;
+            fData[i].time  = time;
+            fData[i].stamp = (fExpiryEnabled) ? jackbridge_frame_time(getClient()) : 0;
+            break;
+        }
+    }
+
+    // must be called with fMutex locked, returns the number of CC messages written to 'msgs'.
+    // Unless 'full', the parts the receiver already has are skipped, e.g. the MSB if it did not change.
+    uint32_t encodeParameter(const int index, const bool full, unsigned char msgs[kParamMaxMessages][3])
+    {
+        // merge groups put everything on the channel of the instance
+        const unsigned char status((fChannel >= 0) ? (unsigned char)(0xB0 | fChannel) : gParamMap.status[index]);
+        const uint16_t value(fParamValues[index]);
+        const unsigned char msb((unsigned char)(value >> 7));
+        const unsigned char lsb((unsigned char)(value & 0x7F));
+
+        bool sendMsb(full || fParamSent[index] == kParamUnsent || (fParamSent[index] >> 7) != msb);
+        uint32_t count = 0;
+
+        fParamSent[index] = value;
+
+        switch (gParamModeMap.mode[index])
+        {
+        case kParamMode14Bit:
+            if (sendMsb)
+                setMessage(msgs[count++], status, gParamMap.cc[index], msb);
+            setMessage(msgs[count++], status, (unsigned char)(gParamMap.cc[index] + 32), lsb);
+            break;
+
+        case kParamModeNRPN:
+        case kParamModeRPN: {
+            const int selection((gParamModeMap.mode[index] == kParamModeNRPN ? 0x4000 : 0) | gParamModeMap.number[index]);
+
+            if (full || fParamSelected[status & 0x0F] != selection)
+            {
+                count  += encodeSelection(selection, status, msgs);
+                sendMsb = true;
+            }
+
+            if (sendMsb)
+                setMessage(msgs[count++], status, 0x06, msb);
+            setMessage(msgs[count++], status, 0x26, lsb);
+            break;
+        }
+
+        default:
+            setMessage(msgs[count++], status, gParamMap.cc[index], msb);
+            break;
+        }
+
+        return count;
+    }
+
+    // must be called with fMutex locked, writes 2 messages
+    uint32_t encodeSelection(const int selection, const unsigned char status, unsigned char msgs[][3])
+    {
+        const bool nrpn((selection & 0x4000) != 0);
+
+        setMessage(msgs[0], status, nrpn ? 0x63 : 0x65, (unsigned char)((selection >> 7) & 0x7F));
+        setMessage(msgs[1], status, nrpn ? 0x62 : 0x64, (unsigned char)(selection & 0x7F));
+
+        fParamSelected[status & 0x0F] = selection;
+        return 2;
+    }
+
+    static void setMessage(unsigned char msg[3], const unsigned char status, const unsigned char cc, const unsigned char value) noexcept
+    {
+        msg[0] = status;
+        msg[1] = cc;
+        msg[2] = value;
+    }
+
+    // must be called with fMutex locked, fills fEvents and returns the event count
+    uint32_t jprocessSort(const jack_nframes_t nframes)
+    {
+        if (fParamHeldAny)
+            jprocessHeld();
+
+        // JACK needs events in time order, host events and parameter changes are queued as they come
+        const jack_nframes_t now(fExpiryEnabled ? jackbridge_last_frame_time(getClient()) : 0);
+        uint32_t eventCount = 0;
+
+        for (fDataUsed = 0; fDataUsed < uint32_t(kMaxMidiEvents); ++fDataUsed)
+        {
+            const uint32_t i(fDataUsed);
+
+            if (fData[i].data[0] == 0)
+                break;
+
+            if (fExpiryEnabled && expireEvent(fData[i], now, nframes))
+                continue;
+
+            jack_nframes_t time;
+
+            if (fData[i].time <= 0)
+                time = 0;
+            else if (jack_nframes_t(fData[i].time) >= nframes)
+                time = nframes-1;
+            else
+                time = jack_nframes_t(fData[i].time);
+
+            uint32_t j = eventCount++;
+
+            for (; j > 0 && fEvents[j-1].time > time; --j)
+                fEvents[j] = fEvents[j-1];
+
+            fEvents[j].time   = time;
+            fEvents[j].size   = fData[i].size;
+            fEvents[j].buffer = fData[i].data;
+        }
+
+        return eventCount;
+    }
+
+    void jprocessAudio(const jack_nframes_t nframes)
+    {
+        float* const buffer1((float*)jackbridge_port_get_buffer(fAudioPorts[0], nframes));
+        float* const buffer2((float*)jackbridge_port_get_buffer(fAudioPorts[1], nframes));
+
+        if (buffer1 == nullptr || buffer2 == nullptr)
+            return;
+
+        pthread_mutex_lock(&fMutex);
+
+        if (fAudioIsOutput)
+            fAudioRing.read(buffer1, buffer2, nframes, 1.0f);
+        else
+            fAudioRing.write(buffer1, buffer2, nframes);
+
+        pthread_mutex_unlock(&fMutex);
+    }
+
+    void jprocessInput(const jack_nframes_t nframes)
+    {
+        void* const portBuffer(jackbridge_port_get_buffer(fInPort, nframes));
+
+        if (portBuffer == nullptr)
+            return;
+
+        const jack_nframes_t cycleStart(jackbridge_last_frame_time(getClient()));
+        const uint32_t eventCount(jackbridge_midi_get_event_count(portBuffer));
+
+        jack_midi_event_t jevent;
+
+        for (uint32_t i=0; i < eventCount; ++i)
+        {
+            if (! jackbridge_midi_event_get(&jevent, portBuffer, i))
+                continue;
+
+            // VstMidiEvent only fits short messages, sysex is not passed on
+            if (jevent.size == 0 || jevent.size > 3)
+                continue;
+
+            if (fInParamsEnabled && jevent.size == 3 && (jevent.buffer[0] & 0xF0) == 0xB0)
+            {
+                const int index(gParamReverseMap.index[jevent.buffer[0] & 0x0F][jevent.buffer[1] & 0x7F]);
+
+                if (index >= 0)
+                {
+                    fInParamValues[index] = jevent.buffer[2] & 0x7F;
+                    __sync_synchronize();
+
+                    // only wake up once, until the change gets picked up
+                    if (! fInParamPending[index])
+                    {
+                        fInParamPending[index] = true;
+                        fInParamWake.post();
+                    }
+                    continue;
+                }
+            }
+
+            const uint32_t head(fInHead);
+
+            // host is not taking events, drop the rest
+            if (head - fInTail >= uint32_t(kMaxMidiEvents))
+                break;
+
+            midi_in_event_t& inEvent(fInEvents[head & (kMaxMidiEvents-1)]);
+            inEvent.frame = cycleStart + jevent.time;
+            inEvent.size  = (unsigned char)jevent.size;
+            std::memset(inEvent.data, 0, 3);
+            std::memcpy(inEvent.data, jevent.buffer, jevent.size);
+
+            __sync_synchronize();
+            fInHead = head + 1;
+        }
+    }
+
+    // split mode jprocess, events are routed by channel to their own port
+    void jprocessSplit(const jack_nframes_t nframes, int& resendBudget)
+    {
+        // last entry is the main port, used for system messages and channels without a port yet
+        void* portBuffers[kMaxSplitPorts+1];
+
+        for (int i=0; i < kMaxSplitPorts; ++i)
+            portBuffers[i] = getPortBuffer(fSplitPorts[i], fSplitConnected[i], fSplitWasConnected[i], nframes);
+
+        portBuffers[kMaxSplitPorts] = getPortBuffer(fPort, fPortConnected, fPortWasConnected, nframes);
+
+        pthread_mutex_lock(&fMutex);
+
+        // state refresh goes first, queued events are newer
+        if (fResendPending)
+        {
+            if (void* const portBuffer = portBuffers[getSplitIndex(0xB0)])
+                jprocessResend(portBuffer, resendBudget, nullptr);
+        }
+
+        const uint32_t eventCount(jprocessSort(nframes));
+
+        // events are sorted, so each port gets them in time order too
+        for (uint32_t i=0; i < eventCount; ++i)
+        {
+            if (void* const portBuffer = portBuffers[getSplitIndex(fEvents[i].buffer[0])])
+                jackbridge_midi_event_write(portBuffer, fEvents[i].time, fEvents[i].buffer, fEvents[i].size);
+        }
+
+        if (fNoteOffPending)
+            jprocessNoteOffs(portBuffers, nullptr, nframes);
+
+        jprocessClear();
+
+        pthread_mutex_unlock(&fMutex);
+    }
+
+    // last cycle after the final disconnection
+    void jprocessIdle(const jack_nframes_t nframes)
+    {
+        getPortBuffer(fPort, false, fPortWasConnected, nframes);
+
+        for (int i=0; i < kMaxSplitPorts; ++i)
+            getPortBuffer(fSplitPorts[i], false, fSplitWasConnected[i], nframes);
+
+        fWasConnected = false;
+    }
+
+    // cleared buffer of a port, or null if nobody reads it.
+    // JACK keeps port buffers between cycles, so a port going idle is cleared one last time;
+    // whoever connects to it next must not get the events of the previous connection.
+    static void* getPortBuffer(jack_port_t* const port, const bool connected, bool& wasConnected, const jack_nframes_t nframes)
+    {
+        if (port == nullptr || ! (connected || wasConnected))
+            return nullptr;
+
+        wasConnected = connected;
+
+        void* const portBuffer(jackbridge_port_get_buffer(port, nframes));
+
+        if (portBuffer != nullptr)
+            jackbridge_midi_clear_buffer(portBuffer);
+
+        return connected ? portBuffer : nullptr;
+    }
+
+    int getSplitIndex(const unsigned char status) const noexcept
+    {
+        if (status < 0x80 || status >= 0xF0 || fSplitPorts[status & 0x0F] == nullptr)
+            return kMaxSplitPorts;
+
+        return status & 0x0F;
+    }
+
+    static void* _splitThread(void* const ptr)
+    {
+        JackAssInstance* const self((JackAssInstance*)ptr);
+
+        for (;;)
+        {
+            self->fSplitWake.wait();
+
+            if (self->fSplitQuit)
+                break;
+
+            for (int i=0; i < kMaxSplitPorts; ++i)
+            {
+                if (! self->fSplitRequested[i] || self->fSplitPorts[i] != nullptr)
+                    continue;
+
+                char strBuf[0xff+1];
+                std::snprintf(strBuf, 0xff, "%s-ch%02i", jackbridge_port_short_name(self->fPort), i+1);
+                strBuf[0xff] = '\0';
+
+                if (jack_port_t* const port = jackbridge_port_register(self->getClient(), strBuf, JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0))
+                {
+                    __sync_synchronize();
+                    self->fSplitPorts[i] = port;
+                }
+            }
+        }
+
+        return nullptr;
+    }
+
+    // must be called with fMutex locked, goes through the shaper of the port if it has one
+    void jprocessResend(void* const portBuffer, int& resendBudget, JackAssDinShaper* const shaper)
+    {
+        int selected[16];
+        std::memcpy(selected, fParamSelected, sizeof(selected));
+
+        unsigned char msgs[kParamMaxMessages][3];
+        int i = 0;
+
+        for (; i < gParamCount; ++i)
+        {
+            if (! fParamResend[i])
+                continue;
+
+            // out of room for this cycle, continue on the next one
+            if (resendBudget < kParamModeMessages[gParamModeMap.mode[i]])
+                break;
+
+            const uint32_t msgCount(encodeParameter(i, true, msgs));
+            writeMessages(portBuffer, shaper, msgs, msgCount);
+
+            if (fParamHeld[i])
+            {
+                fParamHeld[i] = false;
+                --fParamSuppressed[i];
+            }
+
+            fParamResend[i] = false;
+            resendBudget   -= int(msgCount);
+        }
+
+        // queued data entry events may be for the NRPN/RPN that was selected before
+        for (int channel=0; channel < 16; ++channel)
+        {
+            if (selected[channel] >= 0 && fParamSelected[channel] != selected[channel])
+                writeMessages(portBuffer, shaper, msgs, encodeSelection(selected[channel], (unsigned char)(0xB0 | channel), msgs));
+        }
+
+        if (i < gParamCount)
+            return;
+
+        for (i=0; i < gParamCount; ++i)
+            fParamChanged[i] = false;
+
+        fResendPending = false;
+    }
+
+    void writeMessages(void* const portBuffer, JackAssDinShaper* const shaper, const unsigned char msgs[][3], const uint32_t msgCount) const
+    {
+        for (uint32_t i=0; i < msgCount; ++i)
+        {
+            unsigned char data[4] = { msgs[i][0], msgs[i][1], msgs[i][2], 0 };
+
+            if (! prepareEvent(data))
+                continue;
+
+            if (shaper != nullptr)
+                shaper->put(data, 3, 0);
+            else if (unsigned char* const buffer = jackbridge_midi_event_reserve(portBuffer, 0, 3))
+                std::memcpy(buffer, data, 3);
+        }
+    }
+};
+
+// -------------------------------------------------
+// merge mode, up to 16 instances sharing 1 MIDI port, each on its own channel
+
+class JackAssMergeGroup
+{
+public:
+    JackAssMergeGroup(jack_port_t* const port)
+        : fPort(port),
+          fConnected(false),
+          fWasConnected(false),
+          fShaper(nullptr),
+          fShaperReset(false)
+    {
+        for (int i=0; i < kMaxMergeInstances; ++i)
+            fMembers[i] = nullptr;
+    }
+
+    ~JackAssMergeGroup()
+    {
+        if (fShaper != nullptr)
+        {
+            JackAssInstance::printShaperStats(fShaper);
+            delete fShaper;
+            fShaper = nullptr;
+        }
+    }
+
+    // DIN bandwidth shaping for the whole group, must be called before the port is used
+    void enableShaper(const uint32_t sampleRate)
+    {
+        if (fShaper == nullptr)
+            fShaper = new JackAssDinShaper(sampleRate);
+    }
+
+    jack_port_t* getPort() const noexcept
+    {
+        return fPort;
+    }
+
+    bool isEmpty() const noexcept
+    {
+        for (int i=0; i < kMaxMergeInstances; ++i)
+        {
+            if (fMembers[i] != nullptr)
+                return false;
+        }
+        return true;
+    }
+
+    // returns the assigned channel, or -1 if all of the group's slots are in use
+    int addMember(JackAssInstance* const instance, const int maxMembers)
+    {
+        for (int i=0; i < maxMembers && i < kMaxMergeInstances; ++i)
+        {
+            if (fMembers[i] != nullptr)
+                continue;
+
+            instance->setChannel(i);
+            instance->setConnected(fConnected, false);
+            fMembers[i] = instance;
+            return i;
+        }
+
+        return -1;
+    }
+
+    void removeMember(JackAssInstance* const instance) noexcept
+    {
+        for (int i=0; i < kMaxMergeInstances; ++i)
+        {
+            if (fMembers[i] == instance)
+                fMembers[i] = nullptr;
+        }
+    }
+
+    void setConnected(const bool connected, const bool newConnection)
+    {
+        if (fConnected != connected)
+            fShaperReset = true;
+
+        fConnected = connected;
+
+        for (int i=0; i < kMaxMergeInstances; ++i)
+        {
+            if (fMembers[i] != nullptr)
+                fMembers[i]->setConnected(connected, newConnection);
+        }
+    }
+
+    // one buffer clear and one write for the whole group, member queues merged by time
+    void jprocess(const jack_nframes_t nframes, int& resendBudget)
+    {
+        void* const portBuffer(JackAssInstance::getPortBuffer(fPort, fConnected, fWasConnected, nframes));
+
+        if (portBuffer == nullptr)
+            return;
+
+        if (fShaper != nullptr && fShaperReset)
+        {
+            fShaperReset = false;
+            fShaper->reset();
+        }
+
+        JackAssInstance* members[kMaxMergeInstances];
+        uint32_t counts[kMaxMergeInstances];
+        uint32_t pos[kMaxMergeInstances];
+        int memberCount = 0;
+
+        for (int i=0; i < kMaxMergeInstances; ++i)
+        {
+            JackAssInstance* const member(fMembers[i]);
+
+            if (member == nullptr)
+                continue;
+
+            pthread_mutex_lock(&member->fMutex);
+
+            // state refresh goes first, queued events are newer
+            if (member->fResendPending)
+                member->jprocessResend(portBuffer, resendBudget, fShaper);
+
+            members[memberCount] = member;
+            counts[memberCount]  = member->jprocessSort(nframes);
+            pos[memberCount]     = 0;
+            ++memberCount;
+        }
+
+        // every member queue is sorted already, take the earliest head each time.
+        // head times are copied here, so the scan does not touch every member on each event
+        static const jack_nframes_t kQueueDone = 0xFFFFFFFF;
+        jack_nframes_t heads[kMaxMergeInstances];
+        uint32_t eventCount = 0;
+
+        for (int i=0; i < memberCount; ++i)
+            heads[i] = (counts[i] != 0) ? members[i]->fEvents[0].time : kQueueDone;
+
+        while (memberCount != 0)
+        {
+            int next = 0;
+
+            for (int i=1; i < memberCount; ++i)
+            {
+                if (heads[i] < heads[next])
+                    next = i;
+            }
+
+            if (heads[next] == kQueueDone)
+                break;
+
+            const jack_midi_event_t* const events(members[next]->fEvents);
+
+            fEvents[eventCount++] = events[pos[next]++];
+            heads[next] = (pos[next] != counts[next]) ? events[pos[next]].time : kQueueDone;
+        }
+
+        if (fShaper != nullptr)
+        {
+            for (uint32_t i=0; i < eventCount; ++i)
+                fShaper->put(fEvents[i].buffer, fEvents[i].size, fEvents[i].time);
+        }
+        else
+        {
+            jackbridge_midi_events_write(portBuffer, fEvents, eventCount);
+        }
+
+        for (int i=0; i < memberCount; ++i)
+        {
+            if (members[i]->fNoteOffPending)
+                members[i]->jprocessNoteOffs(&portBuffer, fShaper, nframes);
+        }
+
+        if (fShaper != nullptr)
+            fShaper->write(portBuffer, nframes);
+
+        for (int i=0; i < memberCount; ++i)
+        {
+            members[i]->jprocessClear();
+            pthread_mutex_unlock(&members[i]->fMutex);
+        }
+    }
+
+private:
+    jack_port_t*     fPort;
+    JackAssInstance* fMembers[kMaxMergeInstances];
+    volatile bool    fConnected;
+    bool             fWasConnected; // JACK thread only
+
+    JackAssDinShaper* fShaper;
+    volatile bool     fShaperReset;
+
+    jack_midi_event_t fEvents[kMaxMidiEvents*kMaxMergeInstances];
+};
+
+// -------------------------------------------------
+// static list of JackAss instances
+
+static std::list<JackAssInstance*> gInstances;
+static pthread_mutex_t gInstancesMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// merge mode groups, see JACKASS_MERGE, protected by gInstancesMutex too
+static std::list<JackAssMergeGroup*> gMergeGroups;
+
+// optional helper threads for jprocess_callback, see JACKASS_PROCESS_THREADS
+static JackAssWorkerPool gWorkerPool;
+
+// number of instances running their own JACK client, see JACKASS_CLIENT_PER_INSTANCE
+static int gClientInstanceCount = 0;
+
+// -------------------------------------------------
+// JACK calls
+
+// process every instance with (index % parts) == part
+static void jprocess_part(const int part, const int parts, void* const ptr)
+{
+    const jack_nframes_t nframes(*(const jack_nframes_t*)ptr);
+
+    int resendBudget = kMaxResendEvents / parts;
+    int index = 0;
+
+    for (std::list<JackAssInstance*>::iterator it = gInstances.begin(), end = gInstances.end(); it != end; ++it, ++index)
+    {
+        if (index % parts == part)
+            (*it)->jprocess(nframes, resendBudget);
+    }
+
+    for (std::list<JackAssMergeGroup*>::iterator it = gMergeGroups.begin(), end = gMergeGroups.end(); it != end; ++it, ++index)
+    {
+        if (index % parts == part)
+            (*it)->jprocess(nframes, resendBudget);
+    }
+}
+
+static int jprocess_callback(const jack_nframes_t nframes, void*)
+{
+    jack_nframes_t nframesArg(nframes);
+
+    pthread_mutex_lock(&gInstancesMutex);
+
+    gWorkerPool.run(int(gInstances.size() + gMergeGroups.size()) / kMinPartInstances, jprocess_part, &nframesArg);
+
+    pthread_mutex_unlock(&gInstancesMutex);
+    return 0;
+}
+
+static void jfreewheel_callback(const int starting, void*)
+{
+    gJackFreewheel = (starting != 0);
+}
+
+static int jbufsize_callback(const jack_nframes_t nframes, void*)
+{
+    pthread_mutex_lock(&gInstancesMutex);
+
+    for (std::list<JackAssInstance*>::iterator it = gInstances.begin(), end = gInstances.end(); it != end; ++it)
+        (*it)->setAudioBufferSize(nframes);
+
+    pthread_mutex_unlock(&gInstancesMutex);
+    return 0;
+}
+
+// per-instance client mode, each instance gets its own process and connect callbacks
+static int jprocess_instance_callback(const jack_nframes_t nframes, void* const ptr)
+{
+    int resendBudget = kMaxResendEvents;
+    ((JackAssInstance*)ptr)->jprocess(nframes, resendBudget);
+    return 0;
+}
+
+static int jbufsize_instance_callback(const jack_nframes_t nframes, void* const ptr)
+{
+    ((JackAssInstance*)ptr)->setAudioBufferSize(nframes);
+    return 0;
+}
+
+static void jconnect_instance_callback(const jack_port_id_t a, const jack_port_id_t b, const int connect_, void* const ptr)
+{
+    JackAssInstance* const instance((JackAssInstance*)ptr);
+    jack_client_t* const client(instance->getClient());
+
+    if (! instance->ownsPort(jackbridge_port_by_id(client, a)) && ! instance->ownsPort(jackbridge_port_by_id(client, b)))
+        return;
+
+    instance->updateConnections(connect_ != 0);
+}
+
+static void jconnect_update_instance(jack_port_t* const port, const bool newConnection)
+{
+    if (port == nullptr || ! jackbridge_port_is_mine(gJackClient, port))
+        return;
+
+    pthread_mutex_lock(&gInstancesMutex);
+
+    for (std::list<JackAssInstance*>::iterator it = gInstances.begin(), end = gInstances.end(); it != end; ++it)
+    {
+        if (! (*it)->ownsPort(port))
+            continue;
+
+        (*it)->updateConnections(newConnection);
+        break;
+    }
+
+    for (std::list<JackAssMergeGroup*>::iterator it = gMergeGroups.begin(), end = gMergeGroups.end(); it != end; ++it)
+    {
+        if ((*it)->getPort() != port)
+            continue;
+
+        // a port can have several connections, only go idle when the last one is gone
+        (*it)->setConnected(jackbridge_port_connected(port), newConnection);
+        break;
+    }
+
+    pthread_mutex_unlock(&gInstancesMutex);
+}
+
+static void jconnect_callback(const jack_port_id_t a, const jack_port_id_t b, const int connect_, void*)
+{
+    jconnect_update_instance(jackbridge_port_by_id(gJackClient, a), connect_ != 0);
+    jconnect_update_instance(jackbridge_port_by_id(gJackClient, b), connect_ != 0);
+}
+
+// -------------------------------------------------
+// JackAss plugin
+
+class JackAss : public AudioEffectX
+{
+public:
+    JackAss(audioMasterCallback audioMaster)
+        : AudioEffectX(audioMaster, kProgramCount, gParamCount),
+          fInstance(nullptr),
+          fMergeGroup(nullptr),
+          fAudioGain(1.0f),
+          fAutomateRunning(false),
+          fAutomateQuit(false),
+          fBlockPrepared(false),
+          fTimelinePos(0),
+          fTransportPlaying(false),
+          fChunk(nullptr)
+    {
+        for (int i=0; i < gParamCount; ++i)
+        {
+            fParamBuffers[i] = getParameterDefault(i);
+            fParamEcho[i]    = -1.0f;
+        }
+
+        fInVstEvents.numEvents = 0;
+        fInVstEvents.reserved  = 0;
+
+        for (int i=0; i < kMaxMidiEvents; ++i)
+            fInVstEvents.events[i] = (VstEvent*)&fInMidiEvents[i];
+
+#ifdef USE_PROGRAMS
+        for (int i=0; i < kProgramCount; ++i)
+        {
+            fProgramNames[i] = new char[kProgramNameSize+1];
+            std::snprintf(fProgramNames[i], kProgramNameSize, "Program #%i", i+1);
+            fProgramNames[i][kProgramNameSize] = '\0';
+        }
+#endif
+
+        if (audioMaster == nullptr)
+            return;
+
+#ifdef JACKASS_SYNTH
+        isSynth();
+        setNumInputs(0);
+        setNumOutputs(2);
+        setUniqueID(CCONST('J', 'A', 's', 's'));
+#else
+        setNumInputs(2);
+        setNumOutputs(2);
+        setUniqueID(CCONST('J', 'A', 's', 'x'));
+#endif
+        // restored in one step, instead of one setParameter per parameter
+        programsAreChunks();
+
+        char strBuf[0xff+1];
+
+        // Use a port of the JackAss hub if requested and running, "1" or the hub registry name
+        if (const char* const hub = std::getenv("JACKASS_HUB"))
+        {
+            if ((hub[0] == '/' || std::atoi(hub) != 0) && initHubInstance(strBuf, (hub[0] == '/') ? hub : kHubShmName))
+            {
+                initTransform(0);
+                return;
+            }
+        }
+
+        // Write events to shared memory instead of JACK if requested
+        if (const char* const output = std::getenv("JACKASS_OUTPUT"))
+        {
+            if (std::strcmp(output, "shm") == 0 && initShmInstance(strBuf))
+            {
+                initTransform(0);
+                return;
+            }
+        }
+
+        // Register a JACK client just for this plugin if requested
+        if (const char* const perInstance = std::getenv("JACKASS_CLIENT_PER_INSTANCE"))
+        {
+            if (std::atoi(perInstance) != 0)
+            {
+                initClientPerInstance(strBuf);
+                return;
+            }
+        }
+
+        // Register global JACK client if needed
+        if (gJackClient == nullptr)
+        {
+            getClientName(strBuf);
+
+            gJackClient = jackbridge_client_open(strBuf, JackNullOption, nullptr);
+
+            if (gJackClient == nullptr)
+                return;
+
+            jackbridge_set_port_connect_callback(gJackClient, jconnect_callback, nullptr);
+            jackbridge_set_freewheel_callback(gJackClient, jfreewheel_callback, nullptr);
+            jackbridge_set_buffer_size_callback(gJackClient, jbufsize_callback, nullptr);
+            jackbridge_set_process_callback(gJackClient, jprocess_callback, nullptr);
+
+            if (const char* const threads = std::getenv("JACKASS_PROCESS_THREADS"))
+                gWorkerPool.start(std::atoi(threads));
+
+            jackbridge_activate(gJackClient);
+        }
+
+        // Share a jack-port with other instances if requested, 1 channel each
+        if (const char* const merge = std::getenv("JACKASS_MERGE"))
+        {
+            const int maxMembers(std::atoi(merge));
+
+            if (maxMembers > 0 && initMergeInstance(strBuf, maxMembers))
+            {
+                initTransform(0);
+                return;
+            }
+        }
+
+        // Create instance + jack-port for this plugin
+        std::sprintf(strBuf, "midi-out_%02u", (int)gInstances.size() + 1);
+
+        if (jack_port_t* const jport = jackbridge_port_register(gJackClient, strBuf, JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0))
+        {
+            fInstance = new JackAssInstance(jport);
+            initSplit();
+            initShaper();
+
+            const int portNumber((int)gInstances.size() + 1);
+            initTransform(portNumber);
+
+            std::sprintf(strBuf, "midi-in_%02u", portNumber);
+            initInput(gJackClient, strBuf);
+
+            std::sprintf(strBuf, "_%02u", portNumber);
+            initAudioPorts(gJackClient, strBuf);
+            initCvPorts(gJackClient, strBuf);
+
+            pthread_mutex_lock(&gInstancesMutex);
+            gInstances.push_back(fInstance);
+            pthread_mutex_unlock(&gInstancesMutex);
+        }
+    }
+
+    ~JackAss() override
+    {
+        std::free(fChunk);
+
+#ifdef USE_PROGRAMS
+        for (int i=0; i < kProgramCount; ++i)
+        {
+            if (fProgramNames[i] != nullptr)
+            {
+                delete[] fProgramNames[i];
+                fProgramNames[i] = nullptr;
+            }
+        }
+#endif
+
+        if (fAutomateRunning)
+        {
+            fAutomateQuit = true;
+            fInstance->wakeInputParams();
+            pthread_join(fAutomateThread, nullptr);
+            fAutomateRunning = false;
+        }
+
+        // let the JACK thread send note-offs for notes still held
+        if (fInstance != nullptr && fInstance->hasActiveNotes())
+        {
+            fInstance->releaseNotes();
+
+            for (int i=0; i < kNoteOffTimeout && fInstance->hasNoteOffsPending(); ++i)
+                jackass_msleep(1);
+        }
+
+        if (fInstance != nullptr && fInstance->hasOwnClient())
+        {
+            delete fInstance;
+            fInstance = nullptr;
+            --gClientInstanceCount;
+        }
+
+        if (fInstance != nullptr && fMergeGroup != nullptr)
+        {
+            pthread_mutex_lock(&gInstancesMutex);
+            fMergeGroup->removeMember(fInstance);
+
+            if (fMergeGroup->isEmpty())
+                gMergeGroups.remove(fMergeGroup);
+            else
+                fMergeGroup = nullptr;
+
+            pthread_mutex_unlock(&gInstancesMutex);
+
+            delete fInstance;
+            fInstance = nullptr;
+
+            // last member gone
+            if (fMergeGroup != nullptr)
+            {
+                jackbridge_port_unregister(gJackClient, fMergeGroup->getPort());
+                delete fMergeGroup;
+                fMergeGroup = nullptr;
+            }
+        }
+
+        if (fInstance != nullptr)
+        {
+            pthread_mutex_lock(&gInstancesMutex);
+            gInstances.remove(fInstance);
+            pthread_mutex_unlock(&gInstancesMutex);
+
+            delete fInstance;
+            fInstance = nullptr;
+        }
+
+        // Close global JACK client if needed
+        if (gJackClient != nullptr && gInstances.size() == 0 && gMergeGroups.size() == 0)
+        {
+            jackbridge_deactivate(gJackClient);
+            gWorkerPool.stop();
+            jackbridge_client_close(gJackClient);
+            gJackClient = nullptr;
+        }
+    }
+
+    // ---------------------------------------------
+
+    void resume() override
+    {
+        if (fInstance != nullptr && fInstance->hasAudioPorts())
+        {
+            const uint32_t latency(fInstance->initAudio(uint32_t(getBlockSize())));
+
+#ifdef JACKASS_SYNTH
+            // returned audio is late by the ring latency, let the host compensate
+            setInitialDelay(VstInt32(latency));
+            ioChanged();
+#else
+            // the send side latency is not seen by the host
+            (void)latency;
+#endif
+        }
+
+        AudioEffectX::resume();
+    }
+
+    void suspend() override
+    {
+        // notes still held would hang until the host plays them again
+        if (fInstance != nullptr)
+            fInstance->releaseNotes();
+
+        AudioEffectX::suspend();
+    }
+
+    // ---------------------------------------------
+
+    void processReplacing(float** inputs, float** const outputs, const VstInt32 sampleFrames) override
+    {
+        prepareBlock();
+
+        if (fInstance != nullptr && fInstance->hasInputPort())
+            sendInputEvents(sampleFrames);
+
+#ifdef JACKASS_SYNTH
+        if (fInstance != nullptr && fInstance->hasAudioPorts())
+        {
+            // Audio returned from JACK
+            fInstance->getAudio(outputs[0], outputs[1], sampleFrames, fAudioGain);
+        }
+        else
+        {
+            // Silent output
+            std::memset(outputs[0], 0, sizeof(float)*sampleFrames);
+            std::memset(outputs[1], 0, sizeof(float)*sampleFrames);
+        }
+#else
+        // Bypass
+        std::memcpy(outputs[0], inputs[0], sizeof(float)*sampleFrames);
+        std::memcpy(outputs[1], inputs[1], sizeof(float)*sampleFrames);
+
+        // Tap into JACK
+        if (fInstance != nullptr && fInstance->hasAudioPorts())
+            fInstance->putAudio(inputs[0], inputs[1], sampleFrames);
+#endif
+
+        fTimelinePos  += uint64_t(sampleFrames);
+        fBlockPrepared = false;
+
+#ifdef JACKASS_SYNTH
+        return; // unused
+        (void)inputs;
+#endif
+    }
+
+#ifdef JACKASS_SYNTH
+    VstInt32 processEvents(VstEvents* const events) override
+    {
+        if (fInstance == nullptr || events == nullptr)
+            return 0; // FIXME?
+
+        prepareBlock();
+
+        for (VstInt32 i=0; i < events->numEvents; ++i)
+        {
+            if (events->events[i] == nullptr)
+                break;
+            if (events->events[i]->type != kVstMidiType)
+                continue;
+
+            VstMidiEvent* const midiEvent((VstMidiEvent*)events->events[i]);
+            fInstance->putEvent(midiEvent->midiData[0], midiEvent->midiData[1], midiEvent->midiData[2], 3, midiEvent->deltaFrames);
+        }
+
+        return 0;
+    }
+#endif
+
+    // ---------------------------------------------
+
+#ifdef USE_PROGRAMS
+    void setProgram(const VstInt32 program) override
+    {
+        if (curProgram < 0 || curProgram >= kProgramCount)
+            return;
+
+        if (fInstance != nullptr)
         {
             // bank select
             fInstance->putEvent(0xB0, 0x00, 0, 3, 0);
@@ -409,23 +2817,144 @@ public:
 
     // ---------------------------------------------
 
+    VstInt32 getChunk(void** const data, const bool) override
+    {
+        jack_port_t* const port(getOutputPort());
+
+        // port name and connections, see state_header_t
+        char names[0x2000];
+        size_t namesSize = 0;
+
+        if (port != nullptr)
+        {
+            appendName(names, namesSize, jackbridge_port_short_name(port));
+
+            if (const char** const connections = jackbridge_port_get_connections(port))
+            {
+                for (int i=0; connections[i] != nullptr; ++i)
+                    appendName(names, namesSize, connections[i]);
+
+                jackbridge_free(connections);
+            }
+        }
+        else
+        {
+            appendName(names, namesSize, "");
+        }
+
+        names[namesSize++] = '\0';
+
+        const size_t size(sizeof(state_header_t) + sizeof(state_param_t)*size_t(gParamCount) + namesSize);
+        unsigned char* const chunk((unsigned char*)std::realloc(fChunk, size));
+
+        if (chunk == nullptr)
+            return 0;
+
+        fChunk = chunk;
+
+        state_header_t header;
+        std::memcpy(header.magic, kStateMagic, sizeof(kStateMagic));
+        header.version    = kStateVersion;
+        header.paramCount = uint32_t(gParamCount);
+        header.namesSize  = uint32_t(namesSize);
+        std::memcpy(chunk, &header, sizeof(state_header_t));
+
+        state_param_t* const params((state_param_t*)(chunk + sizeof(state_header_t)));
+
+        for (int i=0; i < gParamCount; ++i)
+        {
+            state_param_t param;
+            std::memset(&param, 0, sizeof(state_param_t));
+            param.cc     = gParamMap.cc[i];
+            param.status = gParamMap.status[i];
+            param.value  = fParamBuffers[i];
+            std::memcpy(&params[i], &param, sizeof(state_param_t));
+        }
+
+        std::memcpy(&params[gParamCount], names, namesSize);
+
+        *data = chunk;
+        return VstInt32(size);
+    }
+
+    VstInt32 setChunk(void* const data, const VstInt32 byteSize, const bool) override
+    {
+        const unsigned char* const chunk((const unsigned char*)data);
+
+        state_header_t header;
+
+        if (chunk == nullptr || byteSize < VstInt32(sizeof(state_header_t)))
+            return 0;
+
+        std::memcpy(&header, chunk, sizeof(state_header_t));
+
+        // sizes are checked one at a time against what is left, a sum could wrap
+        const size_t available(size_t(byteSize) - sizeof(state_header_t));
+
+        if (std::memcmp(header.magic, kStateMagic, sizeof(kStateMagic)) != 0 || header.version > kStateVersion ||
+            header.paramCount > uint32_t(kMaxParams) || header.namesSize == 0 ||
+            available < sizeof(state_param_t)*header.paramCount ||
+            header.namesSize > available - sizeof(state_param_t)*header.paramCount)
+        {
+            std::fprintf(stderr, "JackAss: ignoring invalid state chunk\n");
+            return 0;
+        }
+
+        uint16_t values[kMaxParams];
+
+        for (int i=0; i < kMaxParams; ++i)
+            values[i] = kParamUnsent;
+
+        const unsigned char* const params(chunk + sizeof(state_header_t));
+
+        for (uint32_t i=0; i < header.paramCount; ++i)
+        {
+            state_param_t param;
+            std::memcpy(&param, params + sizeof(state_param_t)*i, sizeof(state_param_t));
+
+            if (param.cc >= 128 || (param.status & 0xF0) != 0xB0)
+                continue;
+
+            const int index(gParamReverseMap.index[param.status & 0x0F][param.cc]);
+
+            if (index < 0 || gParamMap.cc[index] != param.cc || ! isParameterValueValid(param.value))
+                continue;
+
+            fParamBuffers[index] = param.value;
+            values[index] = getParameterValue14(param.value);
+        }
+
+        if (fInstance != nullptr)
+            fInstance->restoreParameters(values);
+
+        const char* const names((const char*)(params + sizeof(state_param_t)*header.paramCount));
+
+        if (names[header.namesSize-1] == '\0')
+            restoreConnections(names, names + header.namesSize);
+
+        return 1;
+    }
+
+    // ---------------------------------------------
+
     void setParameter(const VstInt32 index, const float value) override
     {
-        if (index < 0 || index >= kParamCount)
+        if (index < 0 || index >= gParamCount)
             return;
 
         if (fParamBuffers[index] != value)
         {
             fParamBuffers[index] = value;
 
-            if (fInstance != nullptr)
-                fInstance->putEvent(0xB0, kParamMap[index], int(value*127.0f), 3, 0);
+            // values coming from midi-in are not echoed back out
+            if (fInstance != nullptr && ! takeParamEcho(index, value))
+                fInstance->setParameter(index, getParameterValue14(value));
         }
     }
 
     float getParameter(const VstInt32 index) override
     {
-        if (index < 0 || index >= kParamCount)
+        if (index < 0 || index >= gParamCount)
             return 0.0f;
 
         return fParamBuffers[index];
@@ -437,183 +2966,22 @@ public:
         AudioEffectX::getParameterLabel(index, label);
     }
 
-    void getParameterDisplay(const VstInt32 index, char* const text) override
-    {
-        if (index < 0 || index >= kParamCount)
-            return AudioEffectX::getParameterDisplay(index, text); // TODO: REMOVE
-
-        char strBuf[kVstMaxParamStrLen+1];
-        std::snprintf(strBuf, kVstMaxParamStrLen, "%i", int(fParamBuffers[index]*127.0f));
-        strBuf[kVstMaxParamStrLen] = '\0';
-
-        std::strncpy(text, strBuf, kVstMaxParamStrLen);
-    }
-
-    void getParameterName(const VstInt32 index, char* const text) override
-    {
-        if (index < 0 || index >= kParamCount)
-            return AudioEffectX::getParameterName(index, text); // TODO: REMOVE
-
-        static const int kMaxParamLen = 18+1; //28;
-
-        switch (kParamMap[index])
-        {
-        case 0x01:
-            std::strncpy(text, "0x01 Modulation", kMaxParamLen);
-            break;
-        case 0x02:
-            std::strncpy(text, "0x02 Breath", kMaxParamLen);
-            break;
-        case 0x03:
-            std::strncpy(text, "0x03 (Undefined)", kMaxParamLen);
-            break;
-        case 0x04:
-            std::strncpy(text, "0x04 Foot", kMaxParamLen);
-            break;
-        case 0x05:
-            std::strncpy(text, "0x05 Portamento", kMaxParamLen);
-            break;
-        case 0x07:
-            std::strncpy(text, "0x07 Volume", kMaxParamLen);
-            break;
-        case 0x08:
-            std::strncpy(text, "0x08 Balance", kMaxParamLen);
-            break;
-        case 0x09:
-            std::strncpy(text, "0x09 (Undefined)", kMaxParamLen);
-            break;
-        case 0x0A:
-            std::strncpy(text, "0x0A Pan", kMaxParamLen);
-            break;
-        case 0x0B:
-            std::strncpy(text, "0x0B Expression", kMaxParamLen);
-            break;
-        case 0x0C:
-            std::strncpy(text, "0x0C FX Control 1", kMaxParamLen);
-            break;
-        case 0x0D:
-            std::strncpy(text, "0x0D FX Control 2", kMaxParamLen);
-            break;
-        case 0x0E:
-            std::strncpy(text, "0x0E (Undefined)", kMaxParamLen);
-            break;
-        case 0x0F:
-            std::strncpy(text, "0x0F (Undefined)", kMaxParamLen);
-            break;
-        case 0x10:
-            std::strncpy(text, "0x10 Gen Purpose 1", kMaxParamLen);
-            break;
-        case 0x11:
-            std::strncpy(text, "0x11 Gen Purpose 2", kMaxParamLen);
-            break;
-        case 0x12:
-            std::strncpy(text, "0x12 Gen Purpose 3", kMaxParamLen);
-            break;
-        case 0x13:
-            std::strncpy(text, "0x13 Gen Purpose 4", kMaxParamLen);
-            break;
-        case 0x14:
-            std::strncpy(text, "0x14 (Undefined)", kMaxParamLen);
-            break;
-        case 0x15:
-            std::strncpy(text, "0x15 (Undefined)", kMaxParamLen);
-            break;
-        case 0x16:
-            std::strncpy(text, "0x16 (Undefined)", kMaxParamLen);
-            break;
-        case 0x17:
-            std::strncpy(text, "0x17 (Undefined)", kMaxParamLen);
-            break;
-        case 0x18:
-            std::strncpy(text, "0x18 (Undefined)", kMaxParamLen);
-            break;
-        case 0x19:
-            std::strncpy(text, "0x19 (Undefined)", kMaxParamLen);
-            break;
-        case 0x1A:
-            std::strncpy(text, "0x1A (Undefined)", kMaxParamLen);
-            break;
-        case 0x1B:
-            std::strncpy(text, "0x1B (Undefined)", kMaxParamLen);
-            break;
-        case 0x1C:
-            std::strncpy(text, "0x1C (Undefined)", kMaxParamLen);
-            break;
-        case 0x1D:
-            std::strncpy(text, "0x1D (Undefined)", kMaxParamLen);
-            break;
-        case 0x1E:
-            std::strncpy(text, "0x1E (Undefined)", kMaxParamLen);
-            break;
-        case 0x1F:
-            std::strncpy(text, "0x1F (Undefined)", kMaxParamLen);
-            break;
-        case 0x46:
-            std::strncpy(text, "0x46 Control 1", kMaxParamLen); // [Variation]
-            break;
-        case 0x47:
-            std::strncpy(text, "0x47 Control 2", kMaxParamLen); // [Timbre]
-            break;
-        case 0x48:
-            std::strncpy(text, "0x48 Control 3", kMaxParamLen); // [Release]
-            break;
-        case 0x49:
-            std::strncpy(text, "0x49 Control 4", kMaxParamLen); // [Attack]
-            break;
-        case 0x4A:
-            std::strncpy(text, "0x4A Control 5", kMaxParamLen); // [Brightness]
-            break;
-        case 0x4B:
-            std::strncpy(text, "0x4B Control 6", kMaxParamLen); // [Decay]
-            break;
-        case 0x4C:
-            std::strncpy(text, "0x4C Control 7", kMaxParamLen); // [Vib Rate]
-            break;
-        case 0x4D:
-            std::strncpy(text, "0x4D Control 8", kMaxParamLen); // [Vib Depth]
-            break;
-        case 0x4E:
-            std::strncpy(text, "0x4E Control 9", kMaxParamLen); // [Vib Delay]
-            break;
-        case 0x4F:
-            std::strncpy(text, "0x4F Control 10", kMaxParamLen); // [Undefined]
-            break;
-        case 0x50:
-            std::strncpy(text, "0x50 Gen Purpose 5", kMaxParamLen);
-            break;
-        case 0x51:
-            std::strncpy(text, "0x51 Gen Purpose 6", kMaxParamLen);
-            break;
-        case 0x52:
-            std::strncpy(text, "0x52 Gen Purpose 7", kMaxParamLen);
-            break;
-        case 0x53:
-            std::strncpy(text, "0x53 Gen Purpose 8", kMaxParamLen);
-            break;
-        case 0x54:
-            std::strncpy(text, "0x54 Portamento", kMaxParamLen);
-            break;
-        case 0x5B:
-            std::strncpy(text, "0x5B FX 1 Depth", kMaxParamLen); // [Reverb]
-            break;
-        case 0x5C:
-            std::strncpy(text, "0x5C FX 2 Depth", kMaxParamLen); // [Tremolo]
-            break;
-        case 0x5D:
-            std::strncpy(text, "0x5D FX 3 Depth", kMaxParamLen); // [Chorus]
-            break;
-        case 0x5E:
-            std::strncpy(text, "0x5E FX 4 Depth", kMaxParamLen); // [Detune]
-            break;
-        case 0x5F:
-            std::strncpy(text, "0x5F FX 5 Depth", kMaxParamLen); // [Phaser]
-            break;
-        default:
-            AudioEffectX::getParameterName(index, text); // TODO: REMOVE
-            break;
-        }
-    }
-
+    void getParameterDisplay(const VstInt32 index, char* const text) override
+    {
+        if (index < 0 || index >= gParamCount)
+            return AudioEffectX::getParameterDisplay(index, text); // TODO: REMOVE
+
+        std::snprintf(text, kVstMaxParamStrLen, "%i", int(fParamBuffers[index]*127.0f));
+    }
+
+    void getParameterName(const VstInt32 index, char* const text) override
+    {
+        if (index < 0 || index >= gParamCount)
+            return AudioEffectX::getParameterName(index, text); // TODO: REMOVE
+
+        std::strncpy(text, gParamMap.name[index], kParamNameLen);
+    }
+
     // ---------------------------------------------
 
     bool getEffectName(char* const name) override
@@ -649,6 +3017,17 @@ public:
 
     VstInt32 canDo(char* const text) override
     {
+        if (std::strcmp(text, kJackAssCanDoParamBatch) == 0)
+            return 1;
+
+        if (fInstance != nullptr && fInstance->hasInputPort())
+        {
+            if (std::strcmp(text, "sendVstEvents") == 0)
+                return 1;
+            if (std::strcmp(text, "sendVstMidiEvent") == 0)
+                return 1;
+        }
+
 #ifdef JACKASS_SYNTH
         if (std::strcmp(text, "receiveVstEvents") == 0)
             return 1;
@@ -661,6 +3040,37 @@ public:
         (void)text;
     }
 
+    // see JackAssVendor.hpp
+    VstIntPtr vendorSpecific(const VstInt32 index, const VstIntPtr value, void* const ptr, const float opt) override
+    {
+        if (index != kJackAssVendorIndex || value != kJackAssVendorParamBatch || ptr == nullptr)
+            return AudioEffectX::vendorSpecific(index, value, ptr, opt);
+
+        const jackass_param_batch_t* const batch((const jackass_param_batch_t*)ptr);
+
+        if (batch->changes == nullptr)
+            return 0;
+
+        VstIntPtr accepted = 0;
+
+        for (int32_t i=0; i < batch->count; ++i)
+        {
+            const jackass_param_change_t& change(batch->changes[i]);
+
+            if (change.index < 0 || change.index >= gParamCount || change.frame < 0 || ! isParameterValueValid(change.value))
+                continue;
+
+            fParamBuffers[change.index] = change.value;
+            ++accepted;
+
+            // values coming from midi-in are not echoed back out
+            if (fInstance != nullptr && ! takeParamEcho(change.index, change.value))
+                fInstance->setParameter(change.index, getParameterValue14(change.value), true, change.frame);
+        }
+
+        return accepted;
+    }
+
     VstPlugCategory getPlugCategory() override
     {
 #ifdef JACKASS_SYNTH
@@ -683,18 +3093,518 @@ public:
 
     VstInt32 getNumMidiOutputChannels() override
     {
-        return 0;
+        return (fInstance != nullptr && fInstance->hasInputPort()) ? 16 : 0;
     }
 
     // ---------------------------------------------
 
 private:
-    JackAssInstance* fInstance;
+    JackAssInstance*   fInstance;
+    JackAssMergeGroup* fMergeGroup;
+    float              fAudioGain; // for the synth audio return
+
+    // passes midi-in parameter changes to the host, see JACKASS_MIDI_IN_PARAMS
+    bool          fAutomateRunning;
+    volatile bool fAutomateQuit;
+    pthread_t     fAutomateThread;
+    volatile float fParamEcho[kMaxParams]; // value being passed to the host, -1 if none
+
+    bool     fBlockPrepared;
+    uint64_t fTimelinePos;
+    bool     fTransportPlaying;
+
+    // midi-in events for sendVstEventsToHost, VstEvents with room for all of them
+    VstMidiEvent fInMidiEvents[kMaxMidiEvents];
+
+    struct {
+        VstInt32  numEvents;
+        VstIntPtr reserved;
+        VstEvent* events[kMaxMidiEvents];
+    } fInVstEvents;
+
+    // "JackAss-<host>", or just "JackAss" if the host does not tell its name
+    void getClientName(char strBuf[0xff+1])
+    {
+        std::memset(strBuf, 0, sizeof(char)*0xff+1);
+
+        if (getHostProductString(strBuf) && strBuf[0] != '\0')
+        {
+            char tmp[std::strlen(strBuf)+1];
+            std::strcpy(tmp, strBuf);
+#ifdef JACKASS_SYNTH
+            std::strcpy(strBuf, "JackAss-");
+#else
+            std::strcpy(strBuf, "JackAssFX-");
+#endif
+            std::strncat(strBuf, tmp, 0xff-11);
+            strBuf[0xff] = '\0';
+        }
+        else
+        {
+#ifdef JACKASS_SYNTH
+            std::strcpy(strBuf, "JackAss");
+#else
+            std::strcpy(strBuf, "JackAssFX");
+#endif
+        }
+    }
+
+    // shared memory ring, named "/jackass-<pid>-<NN>"
+    bool initShmInstance(char strBuf[0xff+1])
+    {
+#ifdef JACKASS_SHM_UNSUPPORTED
+        return false;
+
+        // unused
+        (void)strBuf;
+#else
+        static int sShmInstanceCount = 0;
+
+        std::snprintf(strBuf, 0xff, "/jackass-%i-%02i", int(getpid()), ++sShmInstanceCount);
+        strBuf[0xff] = '\0';
+
+        fInstance = new JackAssInstance(nullptr);
+
+        if (fInstance->openShm(strBuf, uint32_t(getSampleRate())))
+        {
+            std::fprintf(stderr, "JackAss: sending events to shared memory '%s'\n", strBuf);
+            return true;
+        }
+
+        delete fInstance;
+        fInstance = nullptr;
+        return false;
+#endif
+    }
+
+    // port on the JackAss hub, named "<client name>-<pid>_NN"
+    bool initHubInstance(char strBuf[0xff+1], const char* const shmName)
+    {
+#ifdef JACKASS_HUB_UNSUPPORTED
+        return false;
+
+        // unused
+        (void)strBuf;
+        (void)shmName;
+#else
+        static int sHubInstanceCount = 0;
+
+        getClientName(strBuf);
+
+        const size_t len(std::strlen(strBuf));
+        std::snprintf(strBuf+len, 0xff-len, "-%i_%02i", int(getpid()), ++sHubInstanceCount);
+
+        fInstance = new JackAssInstance(nullptr);
+
+        if (fInstance->openHub(strBuf, shmName))
+            return true;
+
+        delete fInstance;
+        fInstance = nullptr;
+        return false;
+#endif
+    }
+
+    // per-channel ports, if requested
+    void initSplit()
+    {
+        static const char* const split(std::getenv("JACKASS_SPLIT_CHANNELS"));
+
+        if (split != nullptr && std::atoi(split) != 0)
+            fInstance->startSplit();
+    }
+
+    // JACKASS_TRANSFORM_NN for this instance number, or JACKASS_TRANSFORM for all instances
+    void initTransform(const int number)
+    {
+        char envName[32];
+        std::snprintf(envName, 32, "JACKASS_TRANSFORM_%02i", number);
+
+        const char* spec(std::getenv(envName));
+
+        if (number == 0 || spec == nullptr)
+            spec = std::getenv("JACKASS_TRANSFORM");
+
+        if (spec == nullptr || spec[0] == '\0')
+            return;
+
+        JackAssTransform* const transform(new JackAssTransform());
+
+        if (transform->parse(spec))
+            fInstance->setTransform(transform);
+        else
+            delete transform;
+    }
+
+    // DIN MIDI bandwidth shaping, if requested
+    static bool useShaper()
+    {
+        static const char* const shaping(std::getenv("JACKASS_DIN_SHAPING"));
+
+        return (shaping != nullptr && std::atoi(shaping) != 0);
+    }
+
+    void initShaper()
+    {
+        if (useShaper())
+            fInstance->enableShaper();
+    }
+
+    // stereo audio ports if requested, a send for the FX and a return for the synth
+    void initAudioPorts(jack_client_t* const client, const char* const suffix)
+    {
+        static const char* const audioPorts(std::getenv("JACKASS_AUDIO_PORTS"));
+
+        if (audioPorts == nullptr || std::atoi(audioPorts) == 0)
+            return;
+
+#ifdef JACKASS_SYNTH
+        static const char* const returnGain(std::getenv("JACKASS_AUDIO_RETURN_GAIN"));
+
+        if (returnGain != nullptr && returnGain[0] != '\0')
+            fAudioGain = float(std::atof(returnGain));
+
+        const char* const   portPrefix("audio-return");
+        const unsigned long portFlags(JackPortIsInput);
+#else
+        const char* const   portPrefix("audio-send");
+        const unsigned long portFlags(JackPortIsOutput);
+#endif
+
+        char strBuf[0xff+1];
+        jack_port_t* jports[2];
+
+        for (int i=0; i < 2; ++i)
+        {
+            std::snprintf(strBuf, 0xff, "%s%s_%i", portPrefix, suffix, i+1);
+            strBuf[0xff] = '\0';
+
+            jports[i] = jackbridge_port_register(client, strBuf, JACK_DEFAULT_AUDIO_TYPE, portFlags, 0);
+        }
+
+        if (jports[0] == nullptr || jports[1] == nullptr)
+        {
+            for (int i=0; i < 2; ++i)
+            {
+                if (jports[i] != nullptr)
+                    jackbridge_port_unregister(client, jports[i]);
+            }
+            return;
+        }
+
+        fInstance->setAudioPorts(jports[0], jports[1], (portFlags & JackPortIsOutput) != 0);
+    }
+
+    // CV outputs for the parameters listed in JACKASS_CV_PORTS, named like "cv-out_01-cc074",
+    // with the channel for parameters that have one ("cv-out_01-ch02-cc074")
+    void initCvPorts(jack_client_t* const client, const char* const suffix)
+    {
+        if (! gCvModeMap.enabled)
+            return;
+
+        JackAssCv* const cv(new JackAssCv(jackbridge_get_sample_rate(client)));
+        char strBuf[0xff+1];
+
+        for (int i=0; i < gParamCount; ++i)
+        {
+            if (gCvModeMap.mode[i] == kCvOff)
+                continue;
+
+            if (gParamMap.anyChannel[i])
+                std::snprintf(strBuf, 0xff, "cv-out%s-cc%03u", suffix, gParamMap.cc[i]);
+            else
+                std::snprintf(strBuf, 0xff, "cv-out%s-ch%02u-cc%03u", suffix, (gParamMap.status[i] & 0x0F) + 1, gParamMap.cc[i]);
+            strBuf[0xff] = '\0';
+
+            if (jack_port_t* const jport = jackbridge_port_register(client, strBuf, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0))
+                cv->add(jport, i, gCvModeMap.mode[i], float(fInstance->getParameterValue(i)) / 16383.0f);
+        }
+
+        fInstance->setCv(cv);
+    }
+
+    // midi-in port, if requested
+    void initInput(jack_client_t* const client, const char* const portName)
+    {
+        static const char* const midiIn(std::getenv("JACKASS_MIDI_IN"));
 
-    float fParamBuffers[kParamCount];
+        if (midiIn == nullptr || std::atoi(midiIn) == 0)
+            return;
+
+        jack_port_t* const jport(jackbridge_port_register(client, portName, JACK_DEFAULT_MIDI_TYPE, JackPortIsInput, 0));
+
+        if (jport == nullptr)
+            return;
+
+        fInstance->setInputPort(jport);
+
+        static const char* const midiInParams(std::getenv("JACKASS_MIDI_IN_PARAMS"));
+
+        if (midiInParams == nullptr || std::atoi(midiInParams) == 0)
+            return;
+
+        if (pthread_create(&fAutomateThread, nullptr, _automateThread, this) != 0)
+            return;
+
+        fAutomateRunning = true;
+        fInstance->enableInputParams();
+    }
+
+    // true once for the value the automate thread is passing to the host, other values for
+    // the same parameter may come from host automation at the same time and are sent out
+    bool takeParamEcho(const int index, const float value) noexcept
+    {
+        if (fParamEcho[index] != value)
+            return false;
+
+        fParamEcho[index] = -1.0f;
+        return true;
+    }
+
+    // setParameterAutomated is not for the JACK thread, and hosts do not like being flooded
+    static void* _automateThread(void* const ptr)
+    {
+        JackAss* const self((JackAss*)ptr);
+
+        for (;;)
+        {
+            self->fInstance->waitInputParams();
+
+            if (self->fAutomateQuit)
+                break;
+
+            for (int i=0; i < gParamCount; ++i)
+            {
+                unsigned char value;
+
+                if (! self->fInstance->takeInputParam(i, value))
+                    continue;
+
+                // keep the exact 7-bit value for resends, the float conversion may round it down
+                self->fInstance->setParameter(i, uint16_t(value << 7), false);
+
+                self->fParamEcho[i] = float(value)/127.0f;
+                self->setParameterAutomated(i, float(value)/127.0f);
+                self->fParamEcho[i] = -1.0f;
+            }
+
+            // rate limit, changes arriving meanwhile are merged into the next update
+            jackass_msleep(kAutomateInterval);
+        }
+
+        return nullptr;
+    }
+
+    void sendInputEvents(const VstInt32 sampleFrames)
+    {
+        const uint32_t eventCount(fInstance->getInputEvents(fInMidiEvents, kMaxMidiEvents, sampleFrames));
+
+        if (eventCount == 0)
+            return;
+
+        fInVstEvents.numEvents = VstInt32(eventCount);
+        sendVstEventsToHost((VstEvents*)&fInVstEvents);
+    }
+
+    // join the first merge group with a free channel, or start a new one on "midi-merge_NN"
+    bool initMergeInstance(char strBuf[0xff+1], const int maxMembers)
+    {
+        fInstance = new JackAssInstance(nullptr);
+
+        pthread_mutex_lock(&gInstancesMutex);
+
+        for (std::list<JackAssMergeGroup*>::iterator it = gMergeGroups.begin(), end = gMergeGroups.end(); it != end; ++it)
+        {
+            if ((*it)->addMember(fInstance, maxMembers) < 0)
+                continue;
+
+            fMergeGroup = *it;
+            break;
+        }
+
+        pthread_mutex_unlock(&gInstancesMutex);
+
+        if (fMergeGroup != nullptr)
+            return true;
+
+        std::sprintf(strBuf, "midi-merge_%02u", (int)gMergeGroups.size() + 1);
+
+        jack_port_t* const jport(jackbridge_port_register(gJackClient, strBuf, JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0));
+
+        if (jport == nullptr)
+        {
+            delete fInstance;
+            fInstance = nullptr;
+            return false;
+        }
+
+        fMergeGroup = new JackAssMergeGroup(jport);
+        fMergeGroup->addMember(fInstance, maxMembers);
+
+        if (useShaper())
+            fMergeGroup->enableShaper(jackbridge_get_sample_rate(gJackClient));
+
+        pthread_mutex_lock(&gInstancesMutex);
+        gMergeGroups.push_back(fMergeGroup);
+        pthread_mutex_unlock(&gInstancesMutex);
+
+        return true;
+    }
+
+    // one JACK client per plugin instance, named "<client name>_NN"
+    void initClientPerInstance(char strBuf[0xff+1])
+    {
+        getClientName(strBuf);
+
+        const size_t len(std::strlen(strBuf));
+        std::snprintf(strBuf+len, 0xff-len, "_%02i", gClientInstanceCount + 1);
+
+        jack_client_t* const client(jackbridge_client_open(strBuf, JackNullOption, nullptr));
+
+        if (client == nullptr)
+            return;
+
+        jack_port_t* const jport(jackbridge_port_register(client, "midi-out", JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0));
+
+        if (jport == nullptr)
+        {
+            jackbridge_client_close(client);
+            return;
+        }
+
+        fInstance = new JackAssInstance(jport, client);
+        ++gClientInstanceCount;
+        initSplit();
+        initShaper();
+        initTransform(gClientInstanceCount);
+        initInput(client, "midi-in");
+        initAudioPorts(client, "");
+        initCvPorts(client, "");
+
+        jackbridge_set_port_connect_callback(client, jconnect_instance_callback, fInstance);
+        jackbridge_set_freewheel_callback(client, jfreewheel_callback, nullptr);
+        jackbridge_set_buffer_size_callback(client, jbufsize_instance_callback, fInstance);
+        jackbridge_set_process_callback(client, jprocess_instance_callback, fInstance);
+        jackbridge_activate(client);
+    }
+
+    // called once per block, before events or audio, to follow offline/freewheel renders
+    void prepareBlock()
+    {
+        if (fBlockPrepared || fInstance == nullptr)
+            return;
+
+        fBlockPrepared = true;
+
+        const char* const captureDir(getCaptureDir());
+        const bool canCapture(captureDir != nullptr);
+
+        const VstTimeInfo* const timeInfo(getTimeInfo(0));
+
+        // hosts do not always send note-offs when the transport stops
+        if (timeInfo != nullptr)
+        {
+            const bool playing((timeInfo->flags & kVstTransportPlaying) != 0);
+
+            if (fTransportPlaying && ! playing)
+                fInstance->releaseNotes();
+
+            fTransportPlaying = playing;
+        }
+
+        // timestamps are only needed for capture and shared memory output
+        if (! canCapture && ! fInstance->hasOutput())
+            return;
+
+        if (timeInfo != nullptr)
+            fTimelinePos = uint64_t(timeInfo->samplePos);
+
+        fInstance->setTimelinePosition(fTimelinePos);
+
+#ifndef JACKASS_CAPTURE_UNSUPPORTED
+        if (! canCapture)
+            return;
+
+        const bool offline(gJackFreewheel || getCurrentProcessLevel() == kVstProcessLevelOffline);
+
+        if (offline == fInstance->isCapturing())
+            return;
+
+        if (! offline)
+            return fInstance->stopCapture();
+
+        static int sCaptureCount = 0;
+
+        char filename[0xff+1];
+        std::snprintf(filename, 0xff, "%s/%s-%i-%i.jackass", captureDir,
+                      (fInstance->getPort() != nullptr) ? jackbridge_port_short_name(fInstance->getPort())
+                                                        : (fMergeGroup != nullptr) ? jackbridge_port_short_name(fMergeGroup->getPort()) : "output",
+                      int(getpid()), ++sCaptureCount);
+        filename[0xff] = '\0';
+
+        fInstance->startCapture(filename, uint32_t(getSampleRate()), fTimelinePos);
+#endif
+    }
+
+    jack_port_t* getOutputPort() const noexcept
+    {
+        if (fInstance == nullptr)
+            return nullptr;
+
+        if (fInstance->getPort() != nullptr)
+            return fInstance->getPort();
+
+        return (fMergeGroup != nullptr) ? fMergeGroup->getPort() : nullptr;
+    }
+
+    static void appendName(char names[0x2000], size_t& namesSize, const char* const name)
+    {
+        const size_t len(std::strlen(name));
+
+        // keep room for the final '\0'
+        if (namesSize + len + 2 > 0x2000)
+            return;
+
+        std::memcpy(names + namesSize, name, len+1);
+        namesSize += len+1;
+    }
+
+    // port name and connections from a state chunk, 'end' is past the final '\0'
+    void restoreConnections(const char* name, const char* const end)
+    {
+        jack_port_t* const port(getOutputPort());
+
+        if (port == nullptr || *name == '\0')
+            return;
+
+        jack_client_t* const client(fInstance->getClient());
+        char fullName[0xff+1];
+
+        // only our own port can be renamed, and only to a name nobody else has
+        if (port == fInstance->getPort() && std::strcmp(name, jackbridge_port_short_name(port)) != 0)
+        {
+            std::snprintf(fullName, 0xff, "%s:%s", jackbridge_get_client_name(client), name);
+            fullName[0xff] = '\0';
+
+            if (jackbridge_port_by_name(client, fullName) == nullptr)
+                jackbridge_port_set_name(port, name);
+        }
+
+        // ports that are gone are skipped
+        for (name += std::strlen(name)+1; name < end && *name != '\0'; name += std::strlen(name)+1)
+        {
+            if (jackbridge_port_by_name(client, name) != nullptr && ! jackbridge_port_connected_to(port, name))
+                jackbridge_connect(client, jackbridge_port_name(port), name);
+        }
+    }
+
+    float fParamBuffers[kMaxParams];
 #ifdef USE_PROGRAMS
     char* fProgramNames[kProgramCount];
 #endif
+
+    // last state given to the host, kept until the next getChunk
+    unsigned char* fChunk;
 };
 
 // -------------------------------------------------
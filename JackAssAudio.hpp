@@ -0,0 +1,292 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef JACKASS_AUDIO_HPP_INCLUDED
+#define JACKASS_AUDIO_HPP_INCLUDED
+
+#include "jackbridge/JackBridge.hpp"
+
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+# include <xmmintrin.h>
+# define JACKASS_AUDIO_SSE
+#endif
+
+// -------------------------------------------------
+// Audio limits
+
+static const double kAudioDriftGain = 0.00001; // ratio change per frame of fill error
+static const double kAudioMaxDrift  = 0.005;   // max ratio change, 0.5%
+static const double kAudioFillAvg   = 0.05;    // smoothing of the measured fill level
+static const uint32_t kAudioMaxBlock = 8192;   // largest JACK period, the ring has room for it
+static const uint32_t kAudioChunk    = 256;    // frames resampled per pass through the scratch
+
+// -------------------------------------------------
+// stereo (de)interleave, the ring keeps frames interleaved so both channels move together
+
+static inline
+void jackass_interleave(float* const dst, const float* const left, const float* const right, const uint32_t frames) noexcept
+{
+    uint32_t i = 0;
+
+#ifdef JACKASS_AUDIO_SSE
+    for (; i+4 <= frames; i += 4)
+    {
+        const __m128 l(_mm_loadu_ps(left+i));
+        const __m128 r(_mm_loadu_ps(right+i));
+
+        _mm_storeu_ps(dst+i*2,   _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(dst+i*2+4, _mm_unpackhi_ps(l, r));
+    }
+#endif
+
+    for (; i < frames; ++i)
+    {
+        dst[i*2]   = left[i];
+        dst[i*2+1] = right[i];
+    }
+}
+
+static inline
+void jackass_deinterleave_gain(float* const left, float* const right, const float* const src, const uint32_t frames, const float gain) noexcept
+{
+    uint32_t i = 0;
+
+#ifdef JACKASS_AUDIO_SSE
+    const __m128 g(_mm_set1_ps(gain));
+
+    for (; i+4 <= frames; i += 4)
+    {
+        const __m128 a(_mm_loadu_ps(src+i*2));
+        const __m128 b(_mm_loadu_ps(src+i*2+4));
+
+        _mm_storeu_ps(left+i,  _mm_mul_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0)), g));
+        _mm_storeu_ps(right+i, _mm_mul_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1)), g));
+    }
+#endif
+
+    for (; i < frames; ++i)
+    {
+        left[i]  = src[i*2]   * gain;
+        right[i] = src[i*2+1] * gain;
+    }
+}
+
+// -------------------------------------------------
+// lock-free stereo ring between the host and JACK threads
+//
+// One side writes whole blocks, the other reads them back with a slightly varying
+// rate so the fill level stays at the target, which follows the drift between the
+// host and JACK clocks. The target is also the fixed latency of the ring.
+// The ring has room for JACK periods up to kAudioMaxBlock, so a buffer size change only
+// moves the target and never reallocates under the lock-free side.
+
+class JackAssAudioRing
+{
+public:
+    JackAssAudioRing()
+        : fBuffer(nullptr),
+          fSize(0),
+          fTarget(0),
+          fHead(0),
+          fTail(0),
+          fFillAvg(0.0),
+          fPhase(0.0),
+          fOverruns(0),
+          fUnderruns(0) {}
+
+    ~JackAssAudioRing()
+    {
+        clear();
+    }
+
+    // not realtime safe, neither side may be running
+    bool init(const uint32_t target, const uint32_t maxBlock)
+    {
+        clear();
+
+        // room for the target latency plus a few blocks on either side of it
+        const uint32_t block((maxBlock > kAudioMaxBlock) ? maxBlock : kAudioMaxBlock);
+        uint32_t size = 1;
+
+        while (size < (target + block)*2)
+            size *= 2;
+
+        fBuffer = new float[size*2];
+        fSize   = size;
+        fTarget = target;
+
+        // start with the target latency already filled with silence
+        std::memset(fBuffer, 0, sizeof(float)*size*2);
+        fHead    = target;
+        fTail    = 0;
+        fFillAvg = target;
+        fPhase   = 0.0;
+
+        return true;
+    }
+
+    void clear()
+    {
+        if (fBuffer != nullptr)
+        {
+            delete[] fBuffer;
+            fBuffer = nullptr;
+        }
+
+        fSize = fTarget = 0;
+        fHead = fTail = 0;
+    }
+
+    uint32_t getLatency() const noexcept
+    {
+        return fTarget;
+    }
+
+    // new fill level to aim for, reached through the drift correction, not by skipping data
+    void setTarget(const uint32_t target) noexcept
+    {
+        if (fBuffer != nullptr)
+            fTarget = (target < fSize/2) ? target : fSize/2;
+    }
+
+    uint32_t getOverruns() const noexcept
+    {
+        return fOverruns;
+    }
+
+    uint32_t getUnderruns() const noexcept
+    {
+        return fUnderruns;
+    }
+
+    // producer side, the block is dropped if it does not fit
+    void write(const float* const left, const float* const right, const uint32_t frames)
+    {
+        if (fBuffer == nullptr)
+            return;
+
+        const uint32_t head(fHead);
+
+        if (fSize - (head - fTail) < frames)
+        {
+            ++fOverruns;
+            return;
+        }
+
+        const uint32_t start(head & (fSize-1));
+        const uint32_t first((frames < fSize-start) ? frames : fSize-start);
+
+        jackass_interleave(fBuffer+start*2, left, right, first);
+
+        if (first < frames)
+            jackass_interleave(fBuffer, left+first, right+first, frames-first);
+
+        __sync_synchronize();
+        fHead = head + frames;
+    }
+
+    // consumer side, silence if there is not enough data
+    void read(float* const left, float* const right, const uint32_t frames, const float gain)
+    {
+        if (fBuffer == nullptr)
+        {
+            std::memset(left,  0, sizeof(float)*frames);
+            std::memset(right, 0, sizeof(float)*frames);
+            return;
+        }
+
+        const uint32_t head(fHead);
+        __sync_synchronize();
+
+        const uint32_t tail(fTail);
+        const uint32_t fill(head - tail);
+
+        // read a bit faster when the ring fills up, a bit slower when it drains
+        fFillAvg += kAudioFillAvg * (double(fill) - fFillAvg);
+
+        double ratio(1.0 + (fFillAvg - double(fTarget)) * kAudioDriftGain);
+
+        if (ratio < 1.0 - kAudioMaxDrift)
+            ratio = 1.0 - kAudioMaxDrift;
+        else if (ratio > 1.0 + kAudioMaxDrift)
+            ratio = 1.0 + kAudioMaxDrift;
+
+        const double   end(fPhase + double(frames)*ratio);
+        const uint32_t consumed = uint32_t(end);
+
+        // the interpolation needs one frame past the end
+        if (consumed + 1 > fill)
+        {
+            ++fUnderruns;
+            std::memset(left,  0, sizeof(float)*frames);
+            std::memset(right, 0, sizeof(float)*frames);
+            return;
+        }
+
+        // Scalar on purpose: each output frame gathers two input frames at a position that
+        // depends on the ratio and wraps around the ring, which SSE cannot load in one go.
+        // The deinterleave and gain pass after it is the vectorised part.
+        const uint32_t mask(fSize-1);
+
+        for (uint32_t offset=0; offset < frames; offset += kAudioChunk)
+        {
+            const uint32_t count((frames - offset < kAudioChunk) ? frames - offset : kAudioChunk);
+
+            for (uint32_t i=0; i < count; ++i)
+            {
+                const double   pos(fPhase + double(offset+i)*ratio);
+                const uint32_t index = uint32_t(pos);
+                const float    frac(float(pos - double(index)));
+
+                const float* const a(fBuffer + ((tail+index)   & mask)*2);
+                const float* const b(fBuffer + ((tail+index+1) & mask)*2);
+
+                fScratch[i*2]   = a[0] + (b[0]-a[0])*frac;
+                fScratch[i*2+1] = a[1] + (b[1]-a[1])*frac;
+            }
+
+            jackass_deinterleave_gain(left+offset, right+offset, fScratch, count, gain);
+        }
+
+        fPhase = end - double(consumed);
+
+        __sync_synchronize();
+        fTail = tail + consumed;
+    }
+
+private:
+    float*   fBuffer; // interleaved stereo
+    uint32_t fSize;   // in frames, power of 2
+
+    volatile uint32_t fTarget;
+
+    volatile uint32_t fHead;
+    volatile uint32_t fTail;
+
+    // consumer only
+    double fFillAvg;
+    double fPhase;
+    float  fScratch[kAudioChunk*2]; // interleaved
+
+    volatile uint32_t fOverruns;
+    volatile uint32_t fUnderruns;
+};
+
+// -------------------------------------------------
+
+#endif // JACKASS_AUDIO_HPP_INCLUDED
@@ -0,0 +1,382 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef JACKASS_CAPTURE_HPP_INCLUDED
+#define JACKASS_CAPTURE_HPP_INCLUDED
+
+#include "JackAssWorkers.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#if defined(JACKBRIDGE_OS_WIN) && ! defined(__WINE__)
+# define JACKASS_CAPTURE_UNSUPPORTED
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+// -------------------------------------------------
+// Capture file layout, all values in host byte order
+//
+// header: "JAssCapt", uint32 version, uint32 sample rate
+// events: capture_event_t until end of file
+//
+// Event frames are in host timeline position, not JACK time.
+
+static const char     kCaptureMagic[8]   = { 'J', 'A', 's', 's', 'C', 'a', 'p', 't' };
+static const uint32_t kCaptureVersion    = 1;
+static const size_t   kCaptureHeaderSize = 16;
+static const size_t   kCaptureChunkSize  = 4*1024*1024; // file growth step, done by a helper thread
+static const size_t   kCaptureMapSize    = (sizeof(void*) >= 8) ? size_t(1024)*1024*1024 : size_t(128)*1024*1024;
+static const uint32_t kCapturePending    = 4096; // events kept while the helper thread opens the file
+
+struct capture_event_t {
+    uint64_t      frame;
+    unsigned char size;
+    unsigned char data[4];
+    unsigned char reserved[3];
+};
+
+// -------------------------------------------------
+// memory-mapped event capture file, used for offline and freewheel renders
+//
+// The whole kCaptureMapSize window is mapped once, the file behind it grows a chunk at a
+// time. Opening, growing and closing the file is all done by a helper thread, started
+// with start() from a non real-time thread. requestOpen(), requestClose() and write()
+// never do a syscall besides waking the helper, and must all be called from the same
+// thread. Events written before the helper has the file ready are kept in fPending and
+// moved to the file by the first write after that.
+
+class JackAssCapture
+{
+public:
+    JackAssCapture()
+        : fFile(-1),
+          fMap(nullptr),
+          fFileSize(0),
+          fUsed(0),
+          fDropped(0),
+          fWriting(false),
+          fMapped(false),
+          fPending(nullptr),
+          fPendingCount(0),
+          fSampleRate(0),
+          fRequest(0),
+          fReady(0),
+          fOpened(0),
+          fGrowPending(false),
+          fQuit(false),
+          fRunning(false)
+    {
+        fFilename[0] = '\0';
+    }
+
+    ~JackAssCapture()
+    {
+        stop();
+    }
+
+    // helper thread, non real-time
+    bool start()
+    {
+#ifdef JACKASS_CAPTURE_UNSUPPORTED
+        return false;
+#else
+        if (fRunning)
+            return true;
+
+        fPending = new capture_event_t[kCapturePending];
+        fQuit    = false;
+        fRunning = (pthread_create(&fThread, nullptr, _run, this) == 0);
+
+        if (! fRunning)
+        {
+            delete[] fPending;
+            fPending = nullptr;
+        }
+
+        return fRunning;
+#endif
+    }
+
+    // stops the helper thread and closes the file, non real-time
+    void stop()
+    {
+        if (! fRunning)
+            return;
+
+        fWriting = false;
+        fQuit    = true;
+        fWake.post();
+        pthread_join(fThread, nullptr);
+        fRunning = false;
+
+        closeFile();
+
+        delete[] fPending;
+        fPending = nullptr;
+    }
+
+    // the helper thread closes the previous file if needed and opens this one
+    bool requestOpen(const char* const filename, const uint32_t sampleRate)
+    {
+        if (! fRunning)
+            return false;
+
+        std::snprintf(fFilename, sizeof(fFilename), "%s", filename);
+        fSampleRate   = sampleRate;
+        fDropped      = 0;
+        fPendingCount = 0;
+        fMapped       = false;
+        fWriting      = true;
+
+        __sync_synchronize();
+        fRequest = fRequest + 1;
+        fWake.post();
+        return true;
+    }
+
+    void requestClose()
+    {
+        if (! fRunning || ! fWriting)
+            return;
+
+        fWriting = false;
+
+        __sync_synchronize();
+        fRequest = fRequest + 1;
+        fWake.post();
+    }
+
+    bool write(const uint64_t frame, const unsigned char data[4], const unsigned char size)
+    {
+        if (! fWriting)
+            return false;
+
+        capture_event_t event;
+        std::memset(&event, 0, sizeof(capture_event_t));
+        event.frame = frame;
+        event.size  = size;
+        std::memcpy(event.data, data, 4);
+
+        if (! fMapped)
+        {
+            if (fReady != fRequest)
+            {
+                if (fPendingCount == kCapturePending)
+                {
+                    ++fDropped;
+                    return false;
+                }
+
+                fPending[fPendingCount++] = event;
+                return true;
+            }
+
+            __sync_synchronize();
+
+            // the helper could not open the file, count everything as dropped
+            if (fMap == nullptr)
+            {
+                fDropped += fPendingCount + 1;
+                fPendingCount = 0;
+                return false;
+            }
+
+            fMapped = true;
+
+            for (uint32_t i=0; i < fPendingCount; ++i)
+                append(fPending[i]);
+
+            fPendingCount = 0;
+        }
+
+        return append(event);
+    }
+
+private:
+    int             fFile;
+    unsigned char*  fMap;      // kCaptureMapSize bytes, only fFileSize of them are backed by the file
+    volatile size_t fFileSize;
+    size_t          fUsed;
+    uint32_t        fDropped; // writer side, reported when the file is closed
+
+    // writer side
+    bool             fWriting;
+    bool             fMapped;   // fMap is ready for the current request
+    capture_event_t* fPending;
+    uint32_t         fPendingCount;
+
+    // open and close requests, each one bumps fRequest, the helper sets fReady once done
+    char              fFilename[0xff+1];
+    uint32_t          fSampleRate;
+    volatile uint32_t fRequest;
+    volatile uint32_t fReady;
+    uint32_t          fOpened; // helper thread only, request of the open file
+
+    // helper thread
+    volatile bool    fGrowPending;
+    volatile bool    fQuit;
+    bool             fRunning;
+    pthread_t        fThread;
+    JackAssSemaphore fWake;
+
+    bool append(const capture_event_t& event)
+    {
+        // the helper thread fell behind, or the window is full
+        if (fUsed + sizeof(capture_event_t) > fFileSize)
+        {
+            ++fDropped;
+            return false;
+        }
+
+        std::memcpy(fMap+fUsed, &event, sizeof(capture_event_t));
+        fUsed += sizeof(capture_event_t);
+
+        if (fFileSize - fUsed < kCaptureChunkSize && fFileSize < kCaptureMapSize && ! fGrowPending)
+        {
+            fGrowPending = true;
+            fWake.post();
+        }
+
+        return true;
+    }
+
+    // helper thread only, or after it stopped
+
+    void openFile(const char* const filename, const uint32_t sampleRate)
+    {
+#ifdef JACKASS_CAPTURE_UNSUPPORTED
+        // unused
+        (void)filename;
+        (void)sampleRate;
+#else
+        fFile = ::open(filename, O_RDWR|O_CREAT|O_TRUNC, 0644);
+
+        if (fFile < 0)
+        {
+            std::fprintf(stderr, "JackAss: failed to open capture file '%s'\n", filename);
+            return;
+        }
+
+        if (ftruncate(fFile, off_t(kCaptureChunkSize)) != 0)
+            return closeFile();
+
+        void* const map(::mmap(nullptr, kCaptureMapSize, PROT_READ|PROT_WRITE, MAP_SHARED, fFile, 0));
+
+        if (map == MAP_FAILED)
+            return closeFile();
+
+        fMap      = (unsigned char*)map;
+        fFileSize = kCaptureChunkSize;
+
+        std::memcpy(fMap, kCaptureMagic, sizeof(kCaptureMagic));
+        std::memcpy(fMap+8,  &kCaptureVersion, sizeof(uint32_t));
+        std::memcpy(fMap+12, &sampleRate, sizeof(uint32_t));
+        fUsed = kCaptureHeaderSize;
+#endif
+    }
+
+    void closeFile()
+    {
+        if (fFile >= 0 && fDropped != 0)
+            std::fprintf(stderr, "JackAss: capture dropped %u events, the file could not grow in time\n", fDropped);
+
+#ifndef JACKASS_CAPTURE_UNSUPPORTED
+        if (fMap != nullptr)
+        {
+            ::munmap(fMap, kCaptureMapSize);
+            fMap = nullptr;
+        }
+
+        if (fFile >= 0)
+        {
+            // drop the unused tail of the last chunk
+            const int ret(ftruncate(fFile, off_t(fUsed)));
+            ::close(fFile);
+            (void)ret;
+            fFile = -1;
+        }
+#endif
+        fFileSize = 0;
+        fUsed     = 0;
+    }
+
+    void grow()
+    {
+#ifndef JACKASS_CAPTURE_UNSUPPORTED
+        if (fFile < 0)
+            return;
+
+        size_t newSize(fFileSize + kCaptureChunkSize);
+
+        if (newSize > kCaptureMapSize)
+            newSize = kCaptureMapSize;
+
+        if (ftruncate(fFile, off_t(newSize)) == 0)
+        {
+            __sync_synchronize();
+            fFileSize = newSize;
+        }
+#endif
+    }
+
+    static void* _run(void* const ptr)
+    {
+        JackAssCapture* const self((JackAssCapture*)ptr);
+
+        for (;;)
+        {
+            self->fWake.wait();
+
+            if (self->fQuit)
+                break;
+
+            const uint32_t request(self->fRequest);
+
+            if (request != self->fOpened)
+            {
+                __sync_synchronize();
+
+                // the writer stopped touching the old file when it made the request
+                self->closeFile();
+
+                if (self->fWriting)
+                    self->openFile(self->fFilename, self->fSampleRate);
+
+                self->fOpened      = request;
+                self->fGrowPending = false;
+
+                __sync_synchronize();
+                self->fReady = request;
+            }
+
+            if (self->fGrowPending)
+            {
+                self->grow();
+                self->fGrowPending = false;
+            }
+        }
+
+        return nullptr;
+    }
+};
+
+// -------------------------------------------------
+
+#endif // JACKASS_CAPTURE_HPP_INCLUDED
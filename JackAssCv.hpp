@@ -0,0 +1,215 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef JACKASS_CV_HPP_INCLUDED
+#define JACKASS_CV_HPP_INCLUDED
+
+#include "JackAssAudio.hpp"
+
+#include <cmath>
+
+// -------------------------------------------------
+// CV limits
+
+static const int    kMaxCvPorts    = 128;    // one per parameter
+static const int    kCvCurveFrames = 1024;   // longer cycles reuse the curve piecewise
+static const double kCvSmoothTime  = 0.005;  // time constant of smoothed ramps, in seconds
+static const float  kCvSettled     = 1e-6f;  // difference below which a ramp has arrived
+
+enum CvMode {
+    kCvOff    = 0,
+    kCvLinear = 1, // straight line to the new value over one JACK cycle
+    kCvSmooth = 2  // one-pole lowpass towards the new value
+};
+
+// -------------------------------------------------
+// ramp generators, 'frames' values per call
+
+// dst[i] = start + step*(i+1), ends at start + step*frames
+static inline
+void jackass_cv_linear(float* const dst, const float start, const float step, const uint32_t frames) noexcept
+{
+    uint32_t i = 0;
+
+#ifdef JACKASS_AUDIO_SSE
+    const __m128 s(_mm_set1_ps(start));
+    const __m128 d(_mm_set1_ps(step));
+    const __m128 four(_mm_set1_ps(4.0f));
+    __m128 n(_mm_setr_ps(1.0f, 2.0f, 3.0f, 4.0f));
+
+    for (; i+4 <= frames; i += 4)
+    {
+        _mm_storeu_ps(dst+i, _mm_add_ps(s, _mm_mul_ps(d, n)));
+        n = _mm_add_ps(n, four);
+    }
+#endif
+
+    for (; i < frames; ++i)
+        dst[i] = start + step*float(i+1);
+}
+
+// dst[i] = target + diff*curve[i], with curve[i] the decay after i+1 frames
+static inline
+void jackass_cv_smooth(float* const dst, const float target, const float diff, const float* const curve, const uint32_t frames) noexcept
+{
+    uint32_t i = 0;
+
+#ifdef JACKASS_AUDIO_SSE
+    const __m128 t(_mm_set1_ps(target));
+    const __m128 d(_mm_set1_ps(diff));
+
+    for (; i+4 <= frames; i += 4)
+        _mm_storeu_ps(dst+i, _mm_add_ps(t, _mm_mul_ps(d, _mm_loadu_ps(curve+i))));
+#endif
+
+    for (; i < frames; ++i)
+        dst[i] = target + diff*curve[i];
+}
+
+static inline
+void jackass_cv_fill(float* const dst, const float value, const uint32_t frames) noexcept
+{
+    uint32_t i = 0;
+
+#ifdef JACKASS_AUDIO_SSE
+    const __m128 v(_mm_set1_ps(value));
+
+    for (; i+4 <= frames; i += 4)
+        _mm_storeu_ps(dst+i, v);
+#endif
+
+    for (; i < frames; ++i)
+        dst[i] = value;
+}
+
+// -------------------------------------------------
+// CV outputs of one instance, parameter values as JACK audio ports
+//
+// The host thread sets targets, the JACK thread ramps each port from where it was at the
+// end of the previous cycle towards its target. Ports are added before processing starts.
+
+class JackAssCv
+{
+public:
+    JackAssCv(const uint32_t sampleRate)
+        : fCount(0)
+    {
+        // decay of a one-pole lowpass after 1, 2, ... frames
+        const double decay(std::exp(-1.0 / (kCvSmoothTime * double(sampleRate != 0 ? sampleRate : 48000))));
+        double value = 1.0;
+
+        for (int i=0; i < kCvCurveFrames; ++i)
+        {
+            value *= decay;
+            fCurve[i] = float(value);
+        }
+
+        for (int i=0; i < kMaxCvPorts; ++i)
+            fSlots[i] = -1;
+    }
+
+    bool add(jack_port_t* const port, const int index, const int mode, const float value)
+    {
+        if (fCount == kMaxCvPorts || index < 0 || index >= kMaxCvPorts || fSlots[index] >= 0)
+            return false;
+
+        cv_port_t& cv(fPorts[fCount]);
+        cv.port    = port;
+        cv.mode    = mode;
+        cv.current = value;
+        cv.target  = value;
+
+        fSlots[index] = fCount++;
+        return true;
+    }
+
+    void unregisterPorts(jack_client_t* const client)
+    {
+        for (int i=0; i < fCount; ++i)
+            jackbridge_port_unregister(client, fPorts[i].port);
+
+        fCount = 0;
+    }
+
+    // value is 0.0 to 1.0, ignored for parameters without a CV port
+    void setValue(const int index, const float value) noexcept
+    {
+        if (index >= 0 && index < kMaxCvPorts && fSlots[index] >= 0)
+            fPorts[fSlots[index]].target = value;
+    }
+
+    void process(const jack_nframes_t nframes)
+    {
+        for (int i=0; i < fCount; ++i)
+        {
+            cv_port_t& cv(fPorts[i]);
+
+            if (float* const buffer = (float*)jackbridge_port_get_buffer(cv.port, nframes))
+                processPort(cv, buffer, nframes);
+        }
+    }
+
+private:
+    struct cv_port_t {
+        jack_port_t*   port;
+        int            mode;
+        float          current; // JACK thread only
+        volatile float target;
+    };
+
+    cv_port_t fPorts[kMaxCvPorts];
+    int       fSlots[kMaxCvPorts]; // parameter index to fPorts, -1 if none
+    int       fCount;
+    float     fCurve[kCvCurveFrames];
+
+    void processPort(cv_port_t& cv, float* const buffer, const jack_nframes_t nframes)
+    {
+        const float target(cv.target);
+        const float diff(cv.current - target);
+
+        if (std::fabs(diff) < kCvSettled || nframes == 0)
+        {
+            cv.current = target;
+            jackass_cv_fill(buffer, target, nframes);
+            return;
+        }
+
+        if (cv.mode == kCvLinear)
+        {
+            jackass_cv_linear(buffer, cv.current, -diff / float(nframes), nframes);
+            buffer[nframes-1] = target;
+            cv.current = target;
+            return;
+        }
+
+        // curve pieces continue from the last value written
+        float start = cv.current;
+
+        for (jack_nframes_t offset = 0; offset < nframes; offset += kCvCurveFrames)
+        {
+            const jack_nframes_t frames((nframes - offset < jack_nframes_t(kCvCurveFrames)) ? nframes - offset : kCvCurveFrames);
+
+            jackass_cv_smooth(buffer+offset, target, start - target, fCurve, frames);
+            start = buffer[offset+frames-1];
+        }
+
+        cv.current = start;
+    }
+};
+
+// -------------------------------------------------
+
+#endif // JACKASS_CV_HPP_INCLUDED
@@ -0,0 +1,255 @@
+/*
+ * JackAss hub
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// Standalone daemon owning a single JACK client for JackAss instances in any process.
+// Start it before the hosts, then load JackAss with JACKASS_HUB=1 in their environment.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "jackbridge/JackBridge.cpp"
+#include "JackAssHub.hpp"
+
+#ifdef JACKASS_HUB_UNSUPPORTED
+# error The JackAss hub is only supported on Linux
+#endif
+
+// -------------------------------------------------
+// Data limits
+
+static const int kMaxResendEvents = 64; // per JACK cycle, for all ports
+
+// -------------------------------------------------
+// hub state
+
+static jack_client_t*  gJackClient = nullptr;
+static hub_registry_t* gRegistry   = nullptr;
+static volatile bool   gQuit       = false;
+
+static hub_port_t      gPorts[kHubMaxSlots];
+static pthread_mutex_t gPortsMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// -------------------------------------------------
+// JACK calls
+
+static int jprocess_callback(const jack_nframes_t nframes, void*)
+{
+    int resendBudget = kMaxResendEvents;
+
+    pthread_mutex_lock(&gPortsMutex);
+
+    for (int i=0; i < kHubMaxSlots; ++i)
+    {
+        if (gPorts[i].port != nullptr)
+            hub_process_slot(gPorts[i], gRegistry->slots[i], nframes, resendBudget);
+    }
+
+    pthread_mutex_unlock(&gPortsMutex);
+    return 0;
+}
+
+static void jconnect_update_port(jack_port_t* const port, const bool newConnection)
+{
+    if (port == nullptr || ! jackbridge_port_is_mine(gJackClient, port))
+        return;
+
+    const bool connected(jackbridge_port_connected(port));
+
+    pthread_mutex_lock(&gPortsMutex);
+
+    for (int i=0; i < kHubMaxSlots; ++i)
+    {
+        if (gPorts[i].port != port)
+            continue;
+
+        gRegistry->slots[i].connected = connected ? 1 : 0;
+
+        if (connected && newConnection)
+        {
+            gPorts[i].resendPending = true;
+            gPorts[i].resendPos     = 0;
+        }
+        break;
+    }
+
+    pthread_mutex_unlock(&gPortsMutex);
+}
+
+static void jconnect_callback(const jack_port_id_t a, const jack_port_id_t b, const int connect_, void*)
+{
+    jconnect_update_port(jackbridge_port_by_id(gJackClient, a), connect_ != 0);
+    jconnect_update_port(jackbridge_port_by_id(gJackClient, b), connect_ != 0);
+}
+
+// -------------------------------------------------
+// slot management, runs on the main thread
+
+static void hub_close_slot(const int index)
+{
+    hub_slot_t& slot(gRegistry->slots[index]);
+
+    pthread_mutex_lock(&gPortsMutex);
+    jack_port_t* const port(gPorts[index].port);
+    gPorts[index].port = nullptr;
+    pthread_mutex_unlock(&gPortsMutex);
+
+    if (port != nullptr)
+        jackbridge_port_unregister(gJackClient, port);
+
+    slot.connected = 0;
+    __sync_synchronize();
+    slot.state = kHubSlotFree;
+}
+
+// pid 0 and negative values would check process groups instead
+static bool hub_process_alive(const int32_t pid)
+{
+    return (pid > 0 && ::kill(pid, 0) == 0);
+}
+
+static void hub_update_slots()
+{
+    char portName[kHubPortNameSize];
+
+    for (int i=0; i < kHubMaxSlots; ++i)
+    {
+        hub_slot_t& slot(gRegistry->slots[i]);
+
+        switch (slot.state)
+        {
+        case kHubSlotRequested:
+            // the plugin side may not have terminated it
+            std::memcpy(portName, slot.portName, kHubPortNameSize);
+            portName[kHubPortNameSize-1] = '\0';
+
+            if (jack_port_t* const port = jackbridge_port_register(gJackClient, portName, JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0))
+            {
+                pthread_mutex_lock(&gPortsMutex);
+                gPorts[i].port          = port;
+                gPorts[i].resendPending = false;
+                gPorts[i].resendPos     = 0;
+                pthread_mutex_unlock(&gPortsMutex);
+
+                slot.state = kHubSlotActive;
+            }
+            else
+            {
+                std::fprintf(stderr, "JackAss hub: failed to register port '%s'\n", portName);
+                hub_close_slot(i);
+            }
+            break;
+
+        case kHubSlotActive:
+            // the plugin process went away without closing
+            if (! hub_process_alive(slot.pid))
+                hub_close_slot(i);
+            break;
+
+        case kHubSlotClosing:
+            hub_close_slot(i);
+            break;
+        }
+    }
+}
+
+static void hub_signal_handler(int)
+{
+    gQuit = true;
+    hub_futex_wake(&gRegistry->requests);
+}
+
+// -------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    // registry name, plugins find it through JACKASS_HUB
+    const char* const shmName((argc > 1) ? argv[1] : kHubShmName);
+
+    if (shmName[0] != '/')
+    {
+        std::fprintf(stderr, "usage: %s [registry name, starting with '/']\n", argv[0]);
+        return 1;
+    }
+
+    // only processes of the same user can attach, a registry left by an older hub gets fixed too
+    const int fd(::shm_open(shmName, O_RDWR|O_CREAT, 0600));
+
+    if (fd < 0 || ::fchmod(fd, 0600) != 0 || ::ftruncate(fd, sizeof(hub_registry_t)) != 0)
+    {
+        std::fprintf(stderr, "JackAss hub: failed to create shared memory\n");
+        return 1;
+    }
+
+    void* const map(::mmap(nullptr, sizeof(hub_registry_t), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0));
+    ::close(fd);
+
+    if (map == MAP_FAILED)
+    {
+        std::fprintf(stderr, "JackAss hub: failed to map shared memory\n");
+        ::shm_unlink(shmName);
+        return 1;
+    }
+
+    // any leftover from a previous hub is stale
+    gRegistry = (hub_registry_t*)map;
+    std::memset(gRegistry, 0, sizeof(hub_registry_t));
+    gRegistry->magic   = kHubMagic;
+    gRegistry->version = kHubVersion;
+
+    std::memset(gPorts, 0, sizeof(gPorts));
+
+    gJackClient = jackbridge_client_open("JackAss-Hub", JackNullOption, nullptr);
+
+    if (gJackClient == nullptr)
+    {
+        std::fprintf(stderr, "JackAss hub: failed to open JACK client\n");
+        ::munmap(gRegistry, sizeof(hub_registry_t));
+        ::shm_unlink(shmName);
+        return 1;
+    }
+
+    jackbridge_set_port_connect_callback(gJackClient, jconnect_callback, nullptr);
+    jackbridge_set_process_callback(gJackClient, jprocess_callback, nullptr);
+    jackbridge_activate(gJackClient);
+
+    ::signal(SIGINT,  hub_signal_handler);
+    ::signal(SIGTERM, hub_signal_handler);
+
+    __sync_synchronize();
+    gRegistry->hubPid = int32_t(::getpid());
+
+    while (! gQuit)
+    {
+        const int32_t requests(gRegistry->requests);
+        hub_update_slots();
+        hub_futex_wait(&gRegistry->requests, requests, 1000);
+    }
+
+    gRegistry->hubPid = 0;
+
+    jackbridge_deactivate(gJackClient);
+    jackbridge_client_close(gJackClient);
+
+    ::munmap(gRegistry, sizeof(hub_registry_t));
+    ::shm_unlink(shmName);
+
+    return 0;
+}
+
+// -------------------------------------------------
@@ -0,0 +1,330 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef JACKASS_HUB_HPP_INCLUDED
+#define JACKASS_HUB_HPP_INCLUDED
+
+#include "JackAssOutput.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef JACKBRIDGE_OS_LINUX
+# include <fcntl.h>
+# include <linux/futex.h>
+# include <signal.h>
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#else
+# define JACKASS_HUB_UNSUPPORTED
+#endif
+
+// -------------------------------------------------
+// Shared memory between the JackAss hub and plugin instances in any process.
+//
+// The hub owns one JACK client and creates the registry, plugins claim a free slot
+// and write events into its single-producer/single-consumer ring.
+// Slot state changes bump the registry 'requests' futex so the hub can (un)register ports.
+
+static const char     kHubShmName[]    = "/jackass-hub";
+static const uint32_t kHubMagic        = 0x4a417348; // "JAsH"
+static const uint32_t kHubVersion      = 2;
+static const int      kHubMaxSlots     = 256;
+static const uint32_t kHubRingSize     = 1024; // must be power of 2
+static const int      kHubPortNameSize = 64;
+
+enum HubSlotState {
+    kHubSlotFree      = 0,
+    kHubSlotClaimed   = 1, // plugin is filling the slot
+    kHubSlotRequested = 2, // waiting for the hub to register a port
+    kHubSlotActive    = 3,
+    kHubSlotClosing   = 4  // plugin is gone, hub will free the slot
+};
+
+struct hub_event_t {
+    uint32_t      time;
+    unsigned char size;
+    unsigned char data[3];
+};
+
+struct hub_slot_t {
+    volatile int32_t state;
+    int32_t pid;
+    char    portName[kHubPortNameSize];
+
+    // written by the hub from its connect callback
+    volatile int32_t connected;
+
+    // ring indexes, head written by the plugin, tail by the hub
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    hub_event_t events[kHubRingSize];
+
+    // last controller values per channel, resent by the hub on new connections
+    volatile unsigned char ccValues[16][128];
+    volatile unsigned char ccSet[16][128];
+};
+
+struct hub_registry_t {
+    uint32_t magic;
+    uint32_t version;
+    volatile int32_t hubPid;
+    volatile int32_t requests;
+    hub_slot_t slots[kHubMaxSlots];
+};
+
+// -------------------------------------------------
+
+#ifndef JACKASS_HUB_UNSUPPORTED
+static inline
+void hub_futex_wake(volatile int32_t* const word)
+{
+    __sync_fetch_and_add(word, 1);
+    ::syscall(SYS_futex, word, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+
+static inline
+void hub_futex_wait(volatile int32_t* const word, const int32_t value, const long timeoutMs)
+{
+    timespec timeout;
+    timeout.tv_sec  = timeoutMs / 1000;
+    timeout.tv_nsec = (timeoutMs % 1000) * 1000000;
+    ::syscall(SYS_futex, word, FUTEX_WAIT, value, &timeout, nullptr, 0);
+}
+#endif
+
+// -------------------------------------------------
+// hub side of a slot, processed once per JACK cycle
+
+struct hub_port_t {
+    jack_port_t* port;
+    bool resendPending;
+    int  resendPos;
+};
+
+#ifndef JACKASS_HUB_UNSUPPORTED
+static inline
+void hub_process_slot(hub_port_t& hubPort, hub_slot_t& slot, const jack_nframes_t nframes, int& resendBudget)
+{
+    void* const portBuffer(jackbridge_port_get_buffer(hubPort.port, nframes));
+
+    if (portBuffer == nullptr)
+        return;
+
+    jackbridge_midi_clear_buffer(portBuffer);
+
+    const uint32_t head(slot.head);
+    __sync_synchronize();
+
+    // nobody is listening, drop everything.
+    // same for a ring claiming more events than it holds, the other side is not to be trusted
+    if (slot.connected == 0 || head - slot.tail > kHubRingSize)
+    {
+        slot.tail = head;
+        return;
+    }
+
+    // state refresh goes first, queued events are newer
+    for (; hubPort.resendPending && hubPort.resendPos < 16*128; ++hubPort.resendPos)
+    {
+        const int channel(hubPort.resendPos >> 7);
+        const int cc(hubPort.resendPos & 0x7f);
+
+        if (slot.ccSet[channel][cc] == 0)
+            continue;
+        if (resendBudget <= 0)
+            break;
+
+        if (unsigned char* const buffer = jackbridge_midi_event_reserve(portBuffer, 0, 3))
+        {
+            buffer[0] = (unsigned char)(0xB0 | channel);
+            buffer[1] = (unsigned char)cc;
+            buffer[2] = slot.ccValues[channel][cc] & 0x7f;
+        }
+
+        --resendBudget;
+    }
+
+    if (hubPort.resendPos >= 16*128)
+        hubPort.resendPending = false;
+
+    // JACK needs events in time order, only used from the JACK thread
+    static jack_midi_event_t events[kHubRingSize];
+    static hub_event_t       ringEvents[kHubRingSize];
+    uint32_t eventCount = 0;
+
+    for (uint32_t tail = slot.tail; tail != head; ++tail)
+    {
+        ringEvents[eventCount] = slot.events[tail & (kHubRingSize-1)];
+
+        if (ringEvents[eventCount].size == 0 || ringEvents[eventCount].size > 3)
+            continue;
+
+        const jack_nframes_t time((ringEvents[eventCount].time < nframes) ? ringEvents[eventCount].time : nframes-1);
+        uint32_t j = eventCount;
+
+        for (; j > 0 && events[j-1].time > time; --j)
+            events[j] = events[j-1];
+
+        events[j].time   = time;
+        events[j].size   = ringEvents[eventCount].size;
+        events[j].buffer = ringEvents[eventCount].data;
+        ++eventCount;
+    }
+
+    __sync_synchronize();
+    slot.tail = head;
+
+    jackbridge_midi_events_write(portBuffer, events, eventCount);
+}
+#endif
+
+// -------------------------------------------------
+// plugin side of a hub slot
+
+class JackAssHubSlot : public JackAssOutput
+{
+public:
+    JackAssHubSlot()
+        : fRegistry(nullptr),
+          fSlot(nullptr) {}
+
+    ~JackAssHubSlot() override
+    {
+        close();
+    }
+
+    // claims a slot in a running hub, port name must be unique
+    bool open(const char* const portName, const char* const shmName = kHubShmName)
+    {
+#ifdef JACKASS_HUB_UNSUPPORTED
+        return false;
+
+        // unused
+        (void)portName;
+        (void)shmName;
+#else
+        const int fd(::shm_open(shmName, O_RDWR, 0));
+
+        if (fd < 0)
+            return false;
+
+        void* const map(::mmap(nullptr, sizeof(hub_registry_t), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0));
+        ::close(fd);
+
+        if (map == MAP_FAILED)
+            return false;
+
+        fRegistry = (hub_registry_t*)map;
+
+        if (fRegistry->magic != kHubMagic || fRegistry->version != kHubVersion ||
+            fRegistry->hubPid == 0 || ::kill(fRegistry->hubPid, 0) != 0)
+        {
+            std::fprintf(stderr, "JackAss: hub is not running\n");
+            close();
+            return false;
+        }
+
+        for (int i=0; i < kHubMaxSlots; ++i)
+        {
+            hub_slot_t* const slot(&fRegistry->slots[i]);
+
+            if (! __sync_bool_compare_and_swap(&slot->state, kHubSlotFree, kHubSlotClaimed))
+                continue;
+
+            slot->pid       = int32_t(::getpid());
+            slot->connected = 0;
+            slot->head      = 0;
+            slot->tail      = 0;
+            std::memset((void*)slot->ccSet, 0, sizeof(slot->ccSet));
+            std::snprintf(slot->portName, kHubPortNameSize, "%s", portName);
+
+            __sync_synchronize();
+            slot->state = kHubSlotRequested;
+            hub_futex_wake(&fRegistry->requests);
+
+            fSlot = slot;
+            return true;
+        }
+
+        std::fprintf(stderr, "JackAss: hub has no free slots\n");
+        close();
+        return false;
+#endif
+    }
+
+    void close()
+    {
+#ifndef JACKASS_HUB_UNSUPPORTED
+        if (fSlot != nullptr)
+        {
+            fSlot->state = kHubSlotClosing;
+            hub_futex_wake(&fRegistry->requests);
+            fSlot = nullptr;
+        }
+
+        if (fRegistry != nullptr)
+        {
+            ::munmap(fRegistry, sizeof(hub_registry_t));
+            fRegistry = nullptr;
+        }
+#endif
+    }
+
+    bool isConnected() const noexcept override
+    {
+        return (fSlot != nullptr && fSlot->connected != 0);
+    }
+
+    // single producer, callers must serialize. The hub plays events in its next cycle, frame is not used
+    bool write(const unsigned char data[4], const unsigned char size, const uint32_t time, const uint64_t) override
+    {
+        if (fSlot == nullptr || size > 3)
+            return false;
+
+        const uint32_t head(fSlot->head);
+
+        if (head - fSlot->tail >= kHubRingSize)
+            return false;
+
+        hub_event_t& event(fSlot->events[head & (kHubRingSize-1)]);
+        event.time = time;
+        event.size = size;
+        std::memcpy(event.data, data, 3);
+
+        __sync_synchronize();
+        fSlot->head = head + 1;
+        return true;
+    }
+
+    void setController(const unsigned char status, const unsigned char cc, const unsigned char value, const bool set) override
+    {
+        if (fSlot == nullptr)
+            return;
+
+        fSlot->ccValues[status & 0x0F][cc & 0x7f] = value;
+        fSlot->ccSet[status & 0x0F][cc & 0x7f]    = set ? 1 : 0;
+    }
+
+private:
+    hub_registry_t* fRegistry;
+    hub_slot_t*     fSlot;
+};
+
+// -------------------------------------------------
+
+#endif // JACKASS_HUB_HPP_INCLUDED
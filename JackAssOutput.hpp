@@ -0,0 +1,46 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef JACKASS_OUTPUT_HPP_INCLUDED
+#define JACKASS_OUTPUT_HPP_INCLUDED
+
+#include "jackbridge/JackBridge.hpp"
+
+// -------------------------------------------------
+// output backend for events that do not go through our own JACK port
+//
+// Events are pushed as they are queued by the host, from the host audio thread,
+// callers serialize the calls.
+
+class JackAssOutput
+{
+public:
+    virtual ~JackAssOutput() {}
+
+    // if false, events are dropped before reaching write()
+    virtual bool isConnected() const noexcept = 0;
+
+    // time is relative to the current host block, frame is the host timeline position
+    virtual bool write(const unsigned char data[4], unsigned char size, uint32_t time, uint64_t frame) = 0;
+
+    // last value of a controller, for backends that refresh new receivers themselves.
+    // status is 0xB0 | channel, as the event would go out
+    virtual void setController(const unsigned char, const unsigned char, const unsigned char, const bool) {}
+};
+
+// -------------------------------------------------
+
+#endif // JACKASS_OUTPUT_HPP_INCLUDED
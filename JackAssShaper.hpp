@@ -0,0 +1,201 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef JACKASS_SHAPER_HPP_INCLUDED
+#define JACKASS_SHAPER_HPP_INCLUDED
+
+#include "jackbridge/JackBridge.hpp"
+
+#include <cstring>
+
+// -------------------------------------------------
+// Shaper limits
+
+static const double   kDinBytesPerSecond = 3125.0; // 31250 baud, 10 bits per byte
+static const uint32_t kShaperQueueSize   = 1024;   // per priority, must be power of 2
+
+enum ShaperPriority {
+    kShaperRealtime = 0, // clock, start/stop
+    kShaperNote     = 1, // note on/off
+    kShaperOther    = 2, // CC and everything else
+    kShaperPriorityCount
+};
+
+// -------------------------------------------------
+// DIN MIDI bandwidth shaper for one port
+//
+// Models the 31.25 kbaud wire: an event is only written once the previous one would
+// have left the cable, so the interface at the end of the port never has to buffer.
+// When several events wait for the wire, realtime messages go first, then notes, then
+// the rest. Whatever does not fit in a cycle waits for the next ones.
+// JACK thread only.
+
+class JackAssDinShaper
+{
+public:
+    JackAssDinShaper(const uint32_t sampleRate)
+        : fFramesPerByte(double(sampleRate) / kDinBytesPerSecond),
+          fCycleStart(0),
+          fWireFree(0.0),
+          fMaxNoteDelay(0),
+          fDropped(0)
+    {
+        for (int i=0; i < kShaperPriorityCount; ++i)
+            fHead[i] = fTail[i] = 0;
+    }
+
+    // drops everything still waiting, for a new connection
+    void reset() noexcept
+    {
+        for (int i=0; i < kShaperPriorityCount; ++i)
+            fTail[i] = fHead[i];
+
+        fWireFree = 0.0;
+    }
+
+    // worst delay of a note caused by the shaper, in frames
+    uint32_t getMaxNoteDelay() const noexcept
+    {
+        return fMaxNoteDelay;
+    }
+
+    uint32_t getDropped() const noexcept
+    {
+        return fDropped;
+    }
+
+    // time is relative to the current cycle, events must come in time order
+    void put(const unsigned char* const data, const uint32_t size, const jack_nframes_t time)
+    {
+        if (size == 0 || size > 4)
+            return;
+
+        const int prio(getPriority(data[0]));
+        const uint32_t head(fHead[prio]);
+
+        if (head - fTail[prio] >= kShaperQueueSize)
+        {
+            ++fDropped;
+            return;
+        }
+
+        shaper_event_t& event(fQueues[prio][head & (kShaperQueueSize-1)]);
+        event.arrival = fCycleStart + time;
+        event.size    = (unsigned char)size;
+        std::memcpy(event.data, data, size);
+
+        fHead[prio] = head + 1;
+    }
+
+    // writes what the wire can carry in this cycle, must be called once per cycle
+    void write(void* const portBuffer, const jack_nframes_t nframes)
+    {
+        const double cycleStart = double(fCycleStart);
+        const double cycleEnd(cycleStart + double(nframes));
+
+        double wire((fWireFree > cycleStart) ? fWireFree : cycleStart);
+
+        while (wire < cycleEnd)
+        {
+            // highest priority event that is due by the time the wire is free
+            int next = -1;
+            double nextArrival = cycleEnd;
+
+            for (int i=0; i < kShaperPriorityCount; ++i)
+            {
+                if (fHead[i] == fTail[i])
+                    continue;
+
+                const double arrival(double(fQueues[i][fTail[i] & (kShaperQueueSize-1)].arrival));
+
+                if (arrival <= wire)
+                {
+                    next = i;
+                    break;
+                }
+
+                if (arrival < nextArrival)
+                    nextArrival = arrival;
+            }
+
+            // wire is idle until the next event arrives
+            if (next == -1)
+            {
+                if (nextArrival >= cycleEnd)
+                    break;
+
+                wire = nextArrival;
+                continue;
+            }
+
+            const shaper_event_t& event(fQueues[next][fTail[next] & (kShaperQueueSize-1)]);
+
+            if (! jackbridge_midi_event_write(portBuffer, jack_nframes_t(wire - cycleStart), event.data, event.size))
+                break;
+
+            if (next == kShaperNote)
+            {
+                const uint32_t delay(uint32_t(wire - double(event.arrival)));
+
+                if (delay > fMaxNoteDelay)
+                    fMaxNoteDelay = delay;
+            }
+
+            wire += double(event.size) * fFramesPerByte;
+            ++fTail[next];
+        }
+
+        fWireFree    = wire;
+        fCycleStart += nframes;
+    }
+
+private:
+    struct shaper_event_t {
+        uint64_t      arrival; // in frames since the shaper started
+        unsigned char size;
+        unsigned char data[4];
+    };
+
+    const double fFramesPerByte;
+    uint64_t     fCycleStart;
+    double       fWireFree; // when the last event written has left the wire
+
+    shaper_event_t fQueues[kShaperPriorityCount][kShaperQueueSize];
+    uint32_t       fHead[kShaperPriorityCount];
+    uint32_t       fTail[kShaperPriorityCount];
+
+    uint32_t fMaxNoteDelay;
+    uint32_t fDropped;
+
+    static int getPriority(const unsigned char status) noexcept
+    {
+        if (status >= 0xF8)
+            return kShaperRealtime;
+
+        switch (status & 0xF0)
+        {
+        case 0x80:
+        case 0x90:
+            return kShaperNote;
+        default:
+            return kShaperOther;
+        }
+    }
+};
+
+// -------------------------------------------------
+
+#endif // JACKASS_SHAPER_HPP_INCLUDED
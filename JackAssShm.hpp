@@ -0,0 +1,334 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef JACKASS_SHM_HPP_INCLUDED
+#define JACKASS_SHM_HPP_INCLUDED
+
+#include "JackAssCapture.hpp"
+#include "JackAssOutput.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef JACKBRIDGE_OS_LINUX
+# include <cerrno>
+# include <fcntl.h>
+# include <linux/futex.h>
+# include <signal.h>
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#else
+# define JACKASS_SHM_UNSUPPORTED
+#endif
+
+// -------------------------------------------------
+// Shared memory event ring, for consumers that do not use JACK.
+//
+// The plugin creates "/jackass-<pid>-<NN>", readable by its own user only, and is the
+// only writer. A single reader process opens it with JackAssShmReader, and may take the
+// ring over from a reader that died without closing it. Events use the capture file record,
+// stamped with the host timeline position.
+// Readers waiting for events sleep on the 'wakeup' futex, the writer only wakes
+// them when they said they are waiting.
+
+static const char     kShmMagic[8]  = { 'J', 'A', 's', 's', 'R', 'i', 'n', 'g' };
+static const uint32_t kShmVersion   = 1;
+static const uint32_t kShmRingSize  = 1024; // must be power of 2
+
+struct shm_ring_t {
+    char     magic[8];
+    uint32_t version;
+    uint32_t sampleRate;
+
+    volatile int32_t  readerPid; // 0 when nobody is reading
+    volatile int32_t  wakeup;
+    volatile int32_t  waiting;
+    volatile uint32_t lost;      // events dropped because the ring was full
+
+    // head written by the plugin, tail by the reader
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    capture_event_t events[kShmRingSize];
+};
+
+// -------------------------------------------------
+// plugin side
+
+class JackAssShmOutput : public JackAssOutput
+{
+public:
+    JackAssShmOutput()
+        : fRing(nullptr)
+    {
+        fName[0] = '\0';
+    }
+
+    ~JackAssShmOutput() override
+    {
+        close();
+    }
+
+    bool open(const char* const name, const uint32_t sampleRate)
+    {
+#ifdef JACKASS_SHM_UNSUPPORTED
+        return false;
+
+        // unused
+        (void)name;
+        (void)sampleRate;
+#else
+        const int fd(::shm_open(name, O_RDWR|O_CREAT|O_EXCL, 0600));
+
+        if (fd < 0)
+        {
+            std::fprintf(stderr, "JackAss: failed to create shared memory '%s'\n", name);
+            return false;
+        }
+
+        void* map = MAP_FAILED;
+
+        if (::ftruncate(fd, sizeof(shm_ring_t)) == 0)
+            map = ::mmap(nullptr, sizeof(shm_ring_t), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+
+        ::close(fd);
+
+        if (map == MAP_FAILED)
+        {
+            ::shm_unlink(name);
+            return false;
+        }
+
+        fRing = (shm_ring_t*)map;
+        std::memset(fRing, 0, sizeof(shm_ring_t));
+        std::memcpy(fRing->magic, kShmMagic, sizeof(kShmMagic));
+        fRing->version    = kShmVersion;
+        fRing->sampleRate = sampleRate;
+
+        std::snprintf(fName, sizeof(fName), "%s", name);
+        return true;
+#endif
+    }
+
+    void close()
+    {
+#ifndef JACKASS_SHM_UNSUPPORTED
+        if (fRing == nullptr)
+            return;
+
+        ::munmap(fRing, sizeof(shm_ring_t));
+        ::shm_unlink(fName);
+        fRing = nullptr;
+#endif
+    }
+
+    bool isConnected() const noexcept override
+    {
+        return (fRing != nullptr && fRing->readerPid != 0);
+    }
+
+    bool write(const unsigned char data[4], const unsigned char size, const uint32_t, const uint64_t frame) override
+    {
+#ifdef JACKASS_SHM_UNSUPPORTED
+        return false;
+
+        // unused
+        (void)data;
+        (void)size;
+        (void)frame;
+#else
+        if (fRing == nullptr)
+            return false;
+
+        const uint32_t head(fRing->head);
+
+        if (head - fRing->tail >= kShmRingSize)
+        {
+            ++fRing->lost;
+            return false;
+        }
+
+        capture_event_t& event(fRing->events[head & (kShmRingSize-1)]);
+        std::memset(&event, 0, sizeof(capture_event_t));
+        event.frame = frame;
+        event.size  = size;
+        std::memcpy(event.data, data, 4);
+
+        __sync_synchronize();
+        fRing->head = head + 1;
+
+        // pairs with wait(), either we see the reader waiting or it sees the new head
+        __sync_synchronize();
+
+        if (fRing->waiting != 0)
+        {
+            fRing->waiting = 0;
+            __sync_fetch_and_add(&fRing->wakeup, 1);
+            ::syscall(SYS_futex, &fRing->wakeup, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+        }
+
+        return true;
+#endif
+    }
+
+private:
+    shm_ring_t* fRing;
+    char        fName[0xff+1];
+};
+
+// -------------------------------------------------
+// consumer side, for in-house processes reading a JackAss instance
+
+class JackAssShmReader
+{
+public:
+    JackAssShmReader()
+        : fRing(nullptr) {}
+
+    ~JackAssShmReader()
+    {
+        close();
+    }
+
+    bool open(const char* const name)
+    {
+#ifdef JACKASS_SHM_UNSUPPORTED
+        return false;
+
+        // unused
+        (void)name;
+#else
+        close();
+
+        const int fd(::shm_open(name, O_RDWR, 0));
+
+        if (fd < 0)
+            return false;
+
+        void* const map(::mmap(nullptr, sizeof(shm_ring_t), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0));
+        ::close(fd);
+
+        if (map == MAP_FAILED)
+            return false;
+
+        fRing = (shm_ring_t*)map;
+
+        if (std::memcmp(fRing->magic, kShmMagic, sizeof(kShmMagic)) != 0 || fRing->version != kShmVersion || ! attach())
+        {
+            ::munmap(fRing, sizeof(shm_ring_t));
+            fRing = nullptr;
+            return false;
+        }
+
+        // only events from now on
+        fRing->tail = fRing->head;
+        return true;
+#endif
+    }
+
+    void close()
+    {
+#ifndef JACKASS_SHM_UNSUPPORTED
+        if (fRing == nullptr)
+            return;
+
+        __sync_bool_compare_and_swap(&fRing->readerPid, int32_t(::getpid()), 0);
+        ::munmap(fRing, sizeof(shm_ring_t));
+        fRing = nullptr;
+#endif
+    }
+
+    uint32_t getSampleRate() const noexcept
+    {
+        return (fRing != nullptr) ? fRing->sampleRate : 0;
+    }
+
+    uint32_t getLostCount() const noexcept
+    {
+        return (fRing != nullptr) ? fRing->lost : 0;
+    }
+
+    // returns the number of events copied into 'events'
+    uint32_t read(capture_event_t* const events, const uint32_t maxCount)
+    {
+        if (fRing == nullptr)
+            return 0;
+
+        const uint32_t head(fRing->head);
+        __sync_synchronize();
+
+        uint32_t tail(fRing->tail), count = 0;
+
+        for (; tail != head && count < maxCount; ++tail, ++count)
+            events[count] = fRing->events[tail & (kShmRingSize-1)];
+
+        __sync_synchronize();
+        fRing->tail = tail;
+
+        return count;
+    }
+
+    // blocks until events are available or the timeout expires
+    void wait(const long timeoutMs)
+    {
+#ifndef JACKASS_SHM_UNSUPPORTED
+        if (fRing == nullptr)
+            return;
+
+        const int32_t wakeup(fRing->wakeup);
+        fRing->waiting = 1;
+        __sync_synchronize();
+
+        if (fRing->head != fRing->tail)
+        {
+            fRing->waiting = 0;
+            return;
+        }
+
+        timespec timeout;
+        timeout.tv_sec  = timeoutMs / 1000;
+        timeout.tv_nsec = (timeoutMs % 1000) * 1000000;
+        ::syscall(SYS_futex, &fRing->wakeup, FUTEX_WAIT, wakeup, &timeout, nullptr, 0);
+#else
+        // unused
+        (void)timeoutMs;
+#endif
+    }
+
+private:
+    shm_ring_t* fRing;
+
+#ifndef JACKASS_SHM_UNSUPPORTED
+    // claims the ring, a reader that no longer exists does not keep it
+    bool attach()
+    {
+        const int32_t pid(int32_t(::getpid()));
+        const int32_t readerPid(fRing->readerPid);
+
+        if (readerPid == 0)
+            return __sync_bool_compare_and_swap(&fRing->readerPid, 0, pid);
+
+        if (::kill(readerPid, 0) == -1 && errno == ESRCH)
+            return __sync_bool_compare_and_swap(&fRing->readerPid, readerPid, pid);
+
+        return false;
+    }
+#endif
+};
+
+// -------------------------------------------------
+
+#endif // JACKASS_SHM_HPP_INCLUDED
@@ -0,0 +1,235 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef JACKASS_TRANSFORM_HPP_INCLUDED
+#define JACKASS_TRANSFORM_HPP_INCLUDED
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// -------------------------------------------------
+// MIDI transform stage, applied to events as they are queued
+//
+// Everything is precomputed into lookup tables, so an event costs a status lookup
+// (channel remap and type filter, 0 means filtered), plus a note and velocity lookup
+// for note messages.
+//
+// Spec is a ';' separated list of:
+//   channel=<from>:<to>,...   channels are 1-16, '*' as <from> means all
+//   transpose=<semitones>     notes moved out of range are filtered
+//   velocity=<gamma>          note-on velocity curve, 127*(v/127)^gamma
+//   filter=<type>,...         notes, polypressure, cc, program, pressure, pitchbend, system
+
+class JackAssTransform
+{
+public:
+    JackAssTransform()
+    {
+        for (int i=0; i < 256; ++i)
+            fStatus[i] = (i >= 0x80) ? (unsigned char)i : 0;
+
+        for (int i=0; i < 128; ++i)
+        {
+            fNotes[i]    = (unsigned char)i;
+            fVelocity[i] = (unsigned char)i;
+        }
+    }
+
+    // returns false if the event is filtered out
+    bool process(unsigned char data[4]) const noexcept
+    {
+        const unsigned char status(fStatus[data[0]]);
+
+        if (status == 0)
+            return false;
+
+        data[0] = status;
+
+        // note off, note on and poly pressure
+        if (status < 0xB0)
+        {
+            const unsigned char note(fNotes[data[1] & 0x7F]);
+
+            if (note == kFiltered)
+                return false;
+
+            data[1] = note;
+
+            if ((status & 0xF0) == 0x90)
+                data[2] = fVelocity[data[2] & 0x7F];
+        }
+
+        return true;
+    }
+
+    bool parse(const char* const spec)
+    {
+        const char* str(spec);
+
+        while (*str != '\0')
+        {
+            const char* const end(std::strchr(str, ';'));
+            const size_t len((end != nullptr) ? size_t(end - str) : std::strlen(str));
+
+            const size_t itemLen((len < 0xff) ? len : 0xff);
+
+            char item[0xff+1];
+            std::memcpy(item, str, itemLen);
+            item[itemLen] = '\0';
+
+            if (! parseItem(item))
+            {
+                std::fprintf(stderr, "JackAss: invalid transform '%s'\n", item);
+                return false;
+            }
+
+            if (end == nullptr)
+                break;
+
+            str = end+1;
+        }
+
+        return true;
+    }
+
+private:
+    static const unsigned char kFiltered = 0xFF;
+
+    unsigned char fStatus[256];
+    unsigned char fNotes[128];
+    unsigned char fVelocity[128];
+
+    bool parseItem(char* const item)
+    {
+        if (std::strncmp(item, "channel=", 8) == 0)
+        {
+            for (char* next = item+8, *entry; (entry = nextToken(next)) != nullptr;)
+            {
+                char* sep = std::strchr(entry, ':');
+
+                if (sep == nullptr)
+                    return false;
+
+                const int to(std::atoi(sep+1));
+                const int from((entry[0] == '*') ? 0 : std::atoi(entry));
+
+                if (from < 0 || from > 16 || to < 1 || to > 16)
+                    return false;
+
+                for (int channel=0; channel < 16; ++channel)
+                {
+                    if (from != 0 && channel != from-1)
+                        continue;
+
+                    // keeps the type filter of the source channel
+                    for (int type=0x80; type < 0xF0; type += 0x10)
+                    {
+                        if (fStatus[type|channel] != 0)
+                            fStatus[type|channel] = (unsigned char)(type|(to-1));
+                    }
+                }
+            }
+            return true;
+        }
+
+        if (std::strncmp(item, "transpose=", 10) == 0)
+        {
+            const int semitones(std::atoi(item+10));
+
+            for (int i=0; i < 128; ++i)
+            {
+                const int note(fNotes[i] != kFiltered ? fNotes[i] + semitones : -1);
+                fNotes[i] = (note >= 0 && note < 128) ? (unsigned char)note : kFiltered;
+            }
+            return true;
+        }
+
+        if (std::strncmp(item, "velocity=", 9) == 0)
+        {
+            const double gamma(std::atof(item+9));
+
+            if (gamma <= 0.0)
+                return false;
+
+            // 0 stays 0 (note off), everything else stays audible
+            for (int i=1; i < 128; ++i)
+            {
+                const int velocity(int(127.0 * std::pow(double(i)/127.0, gamma) + 0.5));
+                fVelocity[i] = (unsigned char)((velocity < 1) ? 1 : (velocity > 127) ? 127 : velocity);
+            }
+            return true;
+        }
+
+        if (std::strncmp(item, "filter=", 7) == 0)
+        {
+            for (char* next = item+7, *type; (type = nextToken(next)) != nullptr;)
+            {
+                if (std::strcmp(type, "notes") == 0)
+                {
+                    filter(0x80);
+                    filter(0x90);
+                }
+                else if (std::strcmp(type, "polypressure") == 0)
+                    filter(0xA0);
+                else if (std::strcmp(type, "cc") == 0)
+                    filter(0xB0);
+                else if (std::strcmp(type, "program") == 0)
+                    filter(0xC0);
+                else if (std::strcmp(type, "pressure") == 0)
+                    filter(0xD0);
+                else if (std::strcmp(type, "pitchbend") == 0)
+                    filter(0xE0);
+                else if (std::strcmp(type, "system") == 0)
+                    filter(0xF0);
+                else
+                    return false;
+            }
+            return true;
+        }
+
+        return false;
+    }
+
+    // splits a ',' separated list in place, strtok is not thread safe
+    static char* nextToken(char*& str) noexcept
+    {
+        if (str == nullptr || *str == '\0')
+            return nullptr;
+
+        char* const token(str);
+
+        if ((str = std::strchr(str, ',')) != nullptr)
+            *str++ = '\0';
+
+        return token;
+    }
+
+    // every status that is, or got remapped to, this type
+    void filter(const int type) noexcept
+    {
+        for (int i=0x80; i < 256; ++i)
+        {
+            if ((fStatus[i] & 0xF0) == type)
+                fStatus[i] = 0;
+        }
+    }
+};
+
+// -------------------------------------------------
+
+#endif // JACKASS_TRANSFORM_HPP_INCLUDED
@@ -0,0 +1,52 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef JACKASS_VENDOR_HPP_INCLUDED
+#define JACKASS_VENDOR_HPP_INCLUDED
+
+#include <stdint.h>
+
+// -------------------------------------------------
+// Vendor specific extensions, for hosts that want more than plain VST2.
+// This header has no other dependencies, hosts can copy it as is.
+//
+// Sample accurate parameter changes:
+//   canDo("jackAssParamBatch") returns 1 when supported.
+//   dispatcher(effect, effVendorSpecific, kJackAssVendorIndex, kJackAssVendorParamBatch, &batch, 0.0f)
+//   queues every change of 'batch' for the current process block and returns how many were
+//   accepted. Call it from the audio thread before processReplacing, like effProcessEvents.
+//   Frames are offsets into that block, changes of a parameter must come in time order,
+//   values are 0.0 to 1.0.
+//   The host does not need to call setParameter for these, getParameter reflects the last one.
+
+static const char* const kJackAssCanDoParamBatch  = "jackAssParamBatch";
+static const int32_t     kJackAssVendorIndex      = ('J' << 24) | ('A' << 16) | ('s' << 8) | 's';
+static const intptr_t    kJackAssVendorParamBatch = ('P' << 24) | ('B' << 16) | ('a' << 8) | 't';
+
+struct jackass_param_change_t {
+    int32_t index; // parameter index
+    int32_t frame; // offset in the current process block
+    float   value;
+};
+
+struct jackass_param_batch_t {
+    int32_t count;
+    const jackass_param_change_t* changes;
+};
+
+// -------------------------------------------------
+
+#endif // JACKASS_VENDOR_HPP_INCLUDED
@@ -0,0 +1,304 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef JACKASS_WORKERS_HPP_INCLUDED
+#define JACKASS_WORKERS_HPP_INCLUDED
+
+#include "jackbridge/JackBridge.hpp"
+
+#include <cstring>
+#include <pthread.h>
+
+#ifdef JACKBRIDGE_OS_LINUX
+# include <linux/futex.h>
+# include <sys/syscall.h>
+#endif
+
+#ifdef JACKBRIDGE_OS_WIN
+# include <windows.h>
+#else
+# include <unistd.h>
+#endif
+
+// -------------------------------------------------
+// Worker limits
+
+static const int kMaxWorkerThreads = 8;
+static const int kWorkerSpinCount  = 256;
+
+// -------------------------------------------------
+// short sleep, never use it in the JACK thread
+
+static inline
+void jackass_msleep(const unsigned int msecs)
+{
+#ifdef JACKBRIDGE_OS_WIN
+    ::Sleep(msecs);
+#else
+    ::usleep(msecs*1000);
+#endif
+}
+
+// -------------------------------------------------
+// lightweight semaphore, futex based on Linux
+//
+// Waiters announce themselves before sleeping, post() only makes the wake syscall when
+// someone is asleep or about to be. Both sides use full barriers (__sync), so either post()
+// sees the waiter or the waiter sees the new value before FUTEX_WAIT.
+
+class JackAssSemaphore
+{
+public:
+    JackAssSemaphore()
+        : fValue(0),
+          fWaiters(0)
+    {
+#ifndef JACKBRIDGE_OS_LINUX
+        pthread_mutex_init(&fMutex, nullptr);
+        pthread_cond_init(&fCond, nullptr);
+#endif
+    }
+
+    ~JackAssSemaphore()
+    {
+#ifndef JACKBRIDGE_OS_LINUX
+        pthread_cond_destroy(&fCond);
+        pthread_mutex_destroy(&fMutex);
+#endif
+    }
+
+    void post()
+    {
+#ifdef JACKBRIDGE_OS_LINUX
+        __sync_fetch_and_add(&fValue, 1);
+
+        if (fWaiters > 0)
+            ::syscall(SYS_futex, &fValue, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+        pthread_mutex_lock(&fMutex);
+        ++fValue;
+        pthread_cond_signal(&fCond);
+        pthread_mutex_unlock(&fMutex);
+#endif
+    }
+
+    void wait()
+    {
+#ifdef JACKBRIDGE_OS_LINUX
+        // the other side is usually only a few microseconds away, spin a bit before sleeping
+        for (int i=0; i < kWorkerSpinCount; ++i)
+        {
+            if (tryWait())
+                return;
+        }
+
+        __sync_fetch_and_add(&fWaiters, 1);
+
+        while (! tryWait())
+            ::syscall(SYS_futex, &fValue, FUTEX_WAIT_PRIVATE, 0, nullptr, nullptr, 0);
+
+        __sync_fetch_and_sub(&fWaiters, 1);
+#else
+        pthread_mutex_lock(&fMutex);
+
+        while (fValue == 0)
+            pthread_cond_wait(&fCond, &fMutex);
+
+        --fValue;
+        pthread_mutex_unlock(&fMutex);
+#endif
+    }
+
+private:
+    volatile int fValue;
+    volatile int fWaiters; // Linux only, threads in or about to enter FUTEX_WAIT
+
+#ifdef JACKBRIDGE_OS_LINUX
+    bool tryWait()
+    {
+        const int value(fValue);
+        return (value > 0 && __sync_bool_compare_and_swap(&fValue, value, value-1));
+    }
+#else
+    pthread_mutex_t fMutex;
+    pthread_cond_t  fCond;
+#endif
+};
+
+// -------------------------------------------------
+// pool of preallocated threads helping the JACK thread within a cycle
+//
+// The work is split in parts, part 0 always runs on the calling (JACK) thread.
+// run() only returns after every part is done.
+
+typedef void (*JackAssWorkerFunc)(int part, int parts, void* arg);
+
+class JackAssWorkerPool
+{
+public:
+    JackAssWorkerPool()
+        : fThreadCount(0),
+          fQuit(false),
+          fFunc(nullptr),
+          fArg(nullptr),
+          fParts(0),
+          fPending(0),
+          fSchedKnown(false),
+          fSchedPolicy(0)
+    {
+        std::memset(&fSchedParam, 0, sizeof(fSchedParam));
+
+        for (int i=0; i < kMaxWorkerThreads; ++i)
+        {
+            fWorkers[i].pool     = this;
+            fWorkers[i].index    = i;
+            fWorkers[i].schedSet = false;
+        }
+    }
+
+    ~JackAssWorkerPool()
+    {
+        stop();
+    }
+
+    int getThreadCount() const noexcept
+    {
+        return fThreadCount;
+    }
+
+    bool start(int threadCount)
+    {
+        stop();
+
+        if (threadCount > kMaxWorkerThreads)
+            threadCount = kMaxWorkerThreads;
+
+        fQuit = false;
+        fSchedKnown = false;
+
+        for (int i=0; i < threadCount; ++i)
+        {
+            fWorkers[i].schedSet = false;
+
+            if (pthread_create(&fWorkers[i].thread, nullptr, _worker, &fWorkers[i]) != 0)
+                break;
+
+            ++fThreadCount;
+        }
+
+        return (fThreadCount > 0);
+    }
+
+    void stop()
+    {
+        if (fThreadCount == 0)
+            return;
+
+        fQuit = true;
+
+        for (int i=0; i < fThreadCount; ++i)
+            fWorkers[i].wake.post();
+
+        for (int i=0; i < fThreadCount; ++i)
+            pthread_join(fWorkers[i].thread, nullptr);
+
+        fThreadCount = 0;
+    }
+
+    // must be called from the JACK thread, parts includes the calling thread
+    void run(const int parts, JackAssWorkerFunc const func, void* const arg)
+    {
+        if (parts <= 1 || fThreadCount == 0)
+            return func(0, 1, arg);
+
+        const int workers((parts-1 > fThreadCount) ? fThreadCount : parts-1);
+
+        // workers take the scheduling of the JACK thread on their first wake up
+        if (! fSchedKnown)
+        {
+            pthread_getschedparam(pthread_self(), &fSchedPolicy, &fSchedParam);
+            fSchedKnown = true;
+        }
+
+        fFunc    = func;
+        fArg     = arg;
+        fParts   = workers+1;
+        fPending = workers;
+
+        __sync_synchronize();
+
+        for (int i=0; i < workers; ++i)
+            fWorkers[i].wake.post();
+
+        func(0, workers+1, arg);
+
+        fDone.wait();
+    }
+
+private:
+    struct Worker {
+        JackAssWorkerPool* pool;
+        pthread_t        thread;
+        JackAssSemaphore wake;
+        int  index;
+        bool schedSet;
+    };
+
+    Worker fWorkers[kMaxWorkerThreads];
+    int    fThreadCount;
+
+    volatile bool     fQuit;
+    JackAssWorkerFunc fFunc;
+    void*             fArg;
+    int               fParts;
+    volatile int      fPending;
+    JackAssSemaphore  fDone;
+
+    bool        fSchedKnown;
+    int         fSchedPolicy;
+    sched_param fSchedParam;
+
+    static void* _worker(void* const ptr)
+    {
+        Worker* const worker((Worker*)ptr);
+        JackAssWorkerPool* const self(worker->pool);
+
+        for (;;)
+        {
+            worker->wake.wait();
+
+            if (self->fQuit)
+                break;
+
+            if (! worker->schedSet)
+            {
+                worker->schedSet = true;
+                pthread_setschedparam(pthread_self(), self->fSchedPolicy, &self->fSchedParam);
+            }
+
+            self->fFunc(worker->index+1, self->fParts, self->fArg);
+
+            if (__sync_sub_and_fetch(&self->fPending, 1) == 0)
+                self->fDone.post();
+        }
+
+        return nullptr;
+    }
+};
+
+// -------------------------------------------------
+
+#endif // JACKASS_WORKERS_HPP_INCLUDED
@@ -16,6 +16,10 @@
 
 #include "JackBridge.hpp"
 
+#ifdef JACKBRIDGE_FAKE
+# include "JackBridgeFake.cpp"
+#else
+
 #if ! (defined(JACKBRIDGE_DIRECT) || defined(JACKBRIDGE_DUMMY))
 
 #include "JackBridgeLibUtils.hpp"
@@ -60,6 +64,8 @@ typedef int (*jacksym_set_buffer_size)(jack_client_t*, jack_nframes_t);
 typedef jack_nframes_t (*jacksym_get_sample_rate)(jack_client_t*);
 typedef jack_nframes_t (*jacksym_get_buffer_size)(jack_client_t*);
 typedef float          (*jacksym_cpu_load)(jack_client_t*);
+typedef jack_nframes_t (*jacksym_frame_time)(const jack_client_t*);
+typedef jack_nframes_t (*jacksym_last_frame_time)(const jack_client_t*);
 
 typedef jack_port_t* (*jacksym_port_register)(jack_client_t*, const char*, const char*, unsigned long, unsigned long);
 typedef int          (*jacksym_port_unregister)(jack_client_t*, jack_port_t*);
@@ -162,6 +168,8 @@ struct JackBridge {
     jacksym_get_sample_rate get_sample_rate_ptr;
     jacksym_get_buffer_size get_buffer_size_ptr;
     jacksym_cpu_load cpu_load_ptr;
+    jacksym_frame_time frame_time_ptr;
+    jacksym_last_frame_time last_frame_time_ptr;
 
     jacksym_port_register port_register_ptr;
     jacksym_port_unregister port_unregister_ptr;
@@ -254,6 +262,8 @@ struct JackBridge {
           get_sample_rate_ptr(nullptr),
           get_buffer_size_ptr(nullptr),
           cpu_load_ptr(nullptr),
+          frame_time_ptr(nullptr),
+          last_frame_time_ptr(nullptr),
           port_register_ptr(nullptr),
           port_unregister_ptr(nullptr),
           port_get_buffer_ptr(nullptr),
@@ -361,6 +371,8 @@ struct JackBridge {
         LIB_SYMBOL(get_sample_rate)
         LIB_SYMBOL(get_buffer_size)
         LIB_SYMBOL(cpu_load)
+        LIB_SYMBOL(frame_time)
+        LIB_SYMBOL(last_frame_time)
 
         LIB_SYMBOL(port_register)
         LIB_SYMBOL(port_unregister)
@@ -795,6 +807,30 @@ float jackbridge_cpu_load(jack_client_t* client)
     return 0.0f;
 }
 
+jack_nframes_t jackbridge_frame_time(const jack_client_t* client)
+{
+#if JACKBRIDGE_DUMMY
+#elif JACKBRIDGE_DIRECT
+    return jack_frame_time(client);
+#else
+    if (bridge.frame_time_ptr != nullptr)
+        return bridge.frame_time_ptr(client);
+#endif
+    return 0;
+}
+
+jack_nframes_t jackbridge_last_frame_time(const jack_client_t* client)
+{
+#if JACKBRIDGE_DUMMY
+#elif JACKBRIDGE_DIRECT
+    return jack_last_frame_time(client);
+#else
+    if (bridge.last_frame_time_ptr != nullptr)
+        return bridge.last_frame_time_ptr(client);
+#endif
+    return 0;
+}
+
 // -----------------------------------------------------------------------------
 
 jack_port_t* jackbridge_port_register(jack_client_t* client, const char* port_name, const char* port_type, unsigned long flags, unsigned long buffer_size)
@@ -821,17 +857,17 @@ bool jackbridge_port_unregister(jack_client_t* client, jack_port_t* port)
     return false;
 }
 
+#ifndef JACKBRIDGE_DIRECT
 void* jackbridge_port_get_buffer(jack_port_t* port, jack_nframes_t nframes)
 {
 #if JACKBRIDGE_DUMMY
-#elif JACKBRIDGE_DIRECT
-    return jack_port_get_buffer(port, nframes);
 #else
     if (bridge.port_get_buffer_ptr != nullptr)
         return bridge.port_get_buffer_ptr(port, nframes);
 #endif
     return nullptr;
 }
+#endif // ! JACKBRIDGE_DIRECT
 
 // -----------------------------------------------------------------------------
 
@@ -1235,11 +1271,10 @@ bool jackbridge_midi_event_get(jack_midi_event_t* event, void* port_buffer, uint
     return false;
 }
 
+#ifndef JACKBRIDGE_DIRECT
 void jackbridge_midi_clear_buffer(void* port_buffer)
 {
 #if JACKBRIDGE_DUMMY
-#elif JACKBRIDGE_DIRECT
-    jack_midi_clear_buffer(port_buffer);
 #else
     if (bridge.midi_clear_buffer_ptr != nullptr)
         bridge.midi_clear_buffer_ptr(port_buffer);
@@ -1249,8 +1284,6 @@ void jackbridge_midi_clear_buffer(void* port_buffer)
 bool jackbridge_midi_event_write(void* port_buffer, jack_nframes_t time, const jack_midi_data_t* data, size_t data_size)
 {
 #if JACKBRIDGE_DUMMY
-#elif JACKBRIDGE_DIRECT
-    return (jack_midi_event_write(port_buffer, time, data, data_size) == 0);
 #else
     if (bridge.midi_event_write_ptr != nullptr)
         return (bridge.midi_event_write_ptr(port_buffer, time, data, data_size) == 0);
@@ -1261,8 +1294,6 @@ bool jackbridge_midi_event_write(void* port_buffer, jack_nframes_t time, const j
 jack_midi_data_t* jackbridge_midi_event_reserve(void* port_buffer, jack_nframes_t time, size_t data_size)
 {
 #if JACKBRIDGE_DUMMY
-#elif JACKBRIDGE_DIRECT
-    return jack_midi_event_reserve(port_buffer, time, data_size);
 #else
     if (bridge.midi_event_reserve_ptr != nullptr)
         return bridge.midi_event_reserve_ptr(port_buffer, time, data_size);
@@ -1270,6 +1301,28 @@ jack_midi_data_t* jackbridge_midi_event_reserve(void* port_buffer, jack_nframes_
     return nullptr;
 }
 
+uint32_t jackbridge_midi_events_write(void* port_buffer, const jack_midi_event_t* events, uint32_t event_count)
+{
+#if JACKBRIDGE_DUMMY
+#else
+    // resolve the symbol once for the whole batch
+    if (const jacksym_midi_event_write write_ptr = bridge.midi_event_write_ptr)
+    {
+        uint32_t written = 0;
+
+        for (uint32_t i=0; i < event_count; ++i)
+        {
+            if (write_ptr(port_buffer, events[i].time, events[i].buffer, events[i].size) == 0)
+                ++written;
+        }
+
+        return written;
+    }
+#endif
+    return 0;
+}
+#endif // ! JACKBRIDGE_DIRECT
+
 // -----------------------------------------------------------------------------
 
 bool jackbridge_release_timebase(jack_client_t* client)
@@ -1397,3 +1450,5 @@ void jackbridge_transport_stop(jack_client_t* client)
 }
 
 // -----------------------------------------------------------------------------
+
+#endif // ! JACKBRIDGE_FAKE
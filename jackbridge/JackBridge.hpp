@@ -276,10 +276,11 @@ JACKBRIDGE_EXPORT bool jackbridge_set_buffer_size(jack_client_t* client, jack_nf
 JACKBRIDGE_EXPORT jack_nframes_t jackbridge_get_sample_rate(jack_client_t* client);
 JACKBRIDGE_EXPORT jack_nframes_t jackbridge_get_buffer_size(jack_client_t* client);
 JACKBRIDGE_EXPORT float          jackbridge_cpu_load(jack_client_t* client);
+JACKBRIDGE_EXPORT jack_nframes_t jackbridge_frame_time(const jack_client_t* client);
+JACKBRIDGE_EXPORT jack_nframes_t jackbridge_last_frame_time(const jack_client_t* client);
 
 JACKBRIDGE_EXPORT jack_port_t* jackbridge_port_register(jack_client_t* client, const char* port_name, const char* port_type, unsigned long flags, unsigned long buffer_size);
 JACKBRIDGE_EXPORT bool         jackbridge_port_unregister(jack_client_t* client, jack_port_t* port);
-JACKBRIDGE_EXPORT void*        jackbridge_port_get_buffer(jack_port_t* port, jack_nframes_t nframes);
 
 JACKBRIDGE_EXPORT const char*  jackbridge_port_name(const jack_port_t* port);
 JACKBRIDGE_EXPORT const char*  jackbridge_port_short_name(const jack_port_t* port);
@@ -321,9 +322,6 @@ JACKBRIDGE_EXPORT void jackbridge_free(void* ptr);
 
 JACKBRIDGE_EXPORT uint32_t jackbridge_midi_get_event_count(void* port_buffer);
 JACKBRIDGE_EXPORT bool     jackbridge_midi_event_get(jack_midi_event_t* event, void* port_buffer, uint32_t event_index);
-JACKBRIDGE_EXPORT void     jackbridge_midi_clear_buffer(void* port_buffer);
-JACKBRIDGE_EXPORT bool     jackbridge_midi_event_write(void* port_buffer, jack_nframes_t time, const jack_midi_data_t* data, size_t data_size);
-JACKBRIDGE_EXPORT jack_midi_data_t* jackbridge_midi_event_reserve(void* port_buffer, jack_nframes_t time, size_t data_size);
 
 JACKBRIDGE_EXPORT bool jackbridge_release_timebase(jack_client_t* client);
 JACKBRIDGE_EXPORT bool jackbridge_set_sync_callback(jack_client_t* client, JackSyncCallback sync_callback, void* arg);
@@ -338,4 +336,71 @@ JACKBRIDGE_EXPORT bool jackbridge_transport_reposition(jack_client_t* client, co
 JACKBRIDGE_EXPORT void jackbridge_transport_start(jack_client_t* client);
 JACKBRIDGE_EXPORT void jackbridge_transport_stop(jack_client_t* client);
 
+// -----------------------------------------------------------------------------
+// Hot path calls, used once or more per port on every process cycle.
+// When linking to JACK directly these are inlined, otherwise they go through the loaded library.
+//
+// jackbridge_midi_events_write writes several events in one go, they must be sorted by time.
+// Returns the number of events that fit in the port buffer.
+
+#ifdef JACKBRIDGE_DIRECT
+static inline
+void* jackbridge_port_get_buffer(jack_port_t* port, jack_nframes_t nframes)
+{
+    return jack_port_get_buffer(port, nframes);
+}
+
+static inline
+void jackbridge_midi_clear_buffer(void* port_buffer)
+{
+    jack_midi_clear_buffer(port_buffer);
+}
+
+static inline
+bool jackbridge_midi_event_write(void* port_buffer, jack_nframes_t time, const jack_midi_data_t* data, size_t data_size)
+{
+    return (jack_midi_event_write(port_buffer, time, data, data_size) == 0);
+}
+
+static inline
+jack_midi_data_t* jackbridge_midi_event_reserve(void* port_buffer, jack_nframes_t time, size_t data_size)
+{
+    return jack_midi_event_reserve(port_buffer, time, data_size);
+}
+
+static inline
+uint32_t jackbridge_midi_events_write(void* port_buffer, const jack_midi_event_t* events, uint32_t event_count)
+{
+    uint32_t written = 0;
+
+    for (uint32_t i=0; i < event_count; ++i)
+    {
+        if (jack_midi_event_write(port_buffer, events[i].time, events[i].buffer, events[i].size) == 0)
+            ++written;
+    }
+
+    return written;
+}
+#else
+JACKBRIDGE_EXPORT void*    jackbridge_port_get_buffer(jack_port_t* port, jack_nframes_t nframes);
+JACKBRIDGE_EXPORT void     jackbridge_midi_clear_buffer(void* port_buffer);
+JACKBRIDGE_EXPORT bool     jackbridge_midi_event_write(void* port_buffer, jack_nframes_t time, const jack_midi_data_t* data, size_t data_size);
+JACKBRIDGE_EXPORT jack_midi_data_t* jackbridge_midi_event_reserve(void* port_buffer, jack_nframes_t time, size_t data_size);
+JACKBRIDGE_EXPORT uint32_t jackbridge_midi_events_write(void* port_buffer, const jack_midi_event_t* events, uint32_t event_count);
+#endif
+
+// -----------------------------------------------------------------------------
+// In-process fake engine control, only available when building with JACKBRIDGE_FAKE.
+//
+// jackbridge_fake_set_engine sets the sample rate and period for the next cycles.
+// Without the driver thread cycles only run on jackbridge_fake_run_cycles.
+// jackbridge_fake_midi_lost_count returns how many events a MIDI buffer rejected since its last clear.
+
+#ifdef JACKBRIDGE_FAKE
+JACKBRIDGE_EXPORT void     jackbridge_fake_set_engine(jack_nframes_t sample_rate, jack_nframes_t buffer_size, bool use_driver_thread);
+JACKBRIDGE_EXPORT void     jackbridge_fake_set_midi_buffer_size(size_t size);
+JACKBRIDGE_EXPORT void     jackbridge_fake_run_cycles(uint32_t cycles);
+JACKBRIDGE_EXPORT uint32_t jackbridge_fake_midi_lost_count(void* port_buffer);
+#endif
+
 #endif // JACKBRIDGE_HPP_INCLUDED
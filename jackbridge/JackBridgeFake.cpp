@@ -0,0 +1,1305 @@
+/*
+ * JackBridge, in-process fake JACK engine
+ * Copyright (C) 2013 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// This file is included by JackBridge.cpp when JACKBRIDGE_FAKE is defined.
+//
+// It implements the jackbridge API on top of a small in-process engine, so code using
+// JackBridge can run and be measured without a JACK server:
+//  - clients and ports live in a process-wide registry
+//  - MIDI buffers have a fixed byte capacity and reject events like JACK does
+//  - connections are real, input ports see what connected outputs wrote in the same cycle
+//  - port-connect, freewheel, buffer-size and sample-rate callbacks are fired
+//  - cycles run from a driver thread at the configured period, or are stepped by hand
+//
+// Clients are processed in activation order, so sources should be activated before sinks.
+// The driver thread uses clock_nanosleep, meant for Linux CI machines.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <pthread.h>
+
+// -----------------------------------------------------------------------------
+// Fake engine limits
+
+static const jack_nframes_t kFakeMaxBufferSize     = 8192;
+static const size_t         kFakeDefaultMidiSize   = 32768;
+static const size_t         kFakeMidiEventOverhead = 12; // time, size and offset, as in JACK2
+static const int            kFakeNameSize          = 256;
+
+// -----------------------------------------------------------------------------
+// MIDI buffer, events and data share one byte capacity
+
+struct FakeMidiEvent {
+    jack_nframes_t time;
+    uint32_t       size;
+    uint32_t       offset;
+};
+
+struct FakeMidiBuffer {
+    size_t         capacity;
+    size_t         used;
+    uint32_t       count;
+    uint32_t       maxCount;
+    uint32_t       lost;
+    jack_nframes_t nframes;
+    FakeMidiEvent*    events;
+    jack_midi_data_t* data;
+    size_t            dataUsed;
+
+    FakeMidiBuffer(const size_t cap)
+        : capacity(cap),
+          used(0),
+          count(0),
+          maxCount(uint32_t(cap/kFakeMidiEventOverhead)),
+          lost(0),
+          nframes(0),
+          events(new FakeMidiEvent[cap/kFakeMidiEventOverhead]),
+          data(new jack_midi_data_t[cap]),
+          dataUsed(0) {}
+
+    ~FakeMidiBuffer()
+    {
+        delete[] events;
+        delete[] data;
+    }
+
+    void clear() noexcept
+    {
+        used     = 0;
+        count    = 0;
+        lost     = 0;
+        dataUsed = 0;
+    }
+
+    jack_midi_data_t* reserve(const jack_nframes_t time, const size_t size) noexcept
+    {
+        if (size == 0 || time >= nframes || count >= maxCount)
+        {
+            ++lost;
+            return nullptr;
+        }
+
+        // same rules as JACK, events must come in time order and fit in the buffer
+        if ((count > 0 && time < events[count-1].time) || used + kFakeMidiEventOverhead + size > capacity)
+        {
+            ++lost;
+            return nullptr;
+        }
+
+        FakeMidiEvent& event(events[count++]);
+        event.time   = time;
+        event.size   = uint32_t(size);
+        event.offset = uint32_t(dataUsed);
+
+        used     += kFakeMidiEventOverhead + size;
+        dataUsed += size;
+
+        return data + event.offset;
+    }
+};
+
+// -----------------------------------------------------------------------------
+// Clients and ports
+
+struct _jack_port {
+    jack_port_id_t id;
+    jack_client_t* client;
+    char           name[kFakeNameSize];
+    const char*    shortName;
+    bool           isMidi;
+    unsigned long  flags;
+
+    std::vector<jack_port_t*> connections;
+
+    float*          audioBuffer;
+    FakeMidiBuffer* midiBuffer;
+};
+
+struct _jack_client {
+    char name[kFakeNameSize];
+    bool active;
+
+    std::vector<jack_port_t*> ports;
+
+    JackProcessCallback     processCallback;
+    void*                   processArg;
+    JackPortConnectCallback connectCallback;
+    void*                   connectArg;
+    JackFreewheelCallback   freewheelCallback;
+    void*                   freewheelArg;
+    JackBufferSizeCallback  bufferSizeCallback;
+    void*                   bufferSizeArg;
+    JackSampleRateCallback  sampleRateCallback;
+    void*                   sampleRateArg;
+};
+
+// -----------------------------------------------------------------------------
+// Engine
+
+struct FakeJackEngine {
+    // protects clients, ports and connections, held for the whole process cycle
+    pthread_mutex_t mutex;
+
+    std::vector<jack_client_t*> clients; // in activation order
+    std::vector<jack_port_t*>   ports;   // indexed by port id, unregistered ports are null
+
+    jack_nframes_t sampleRate;
+    jack_nframes_t bufferSize;
+    size_t         midiBufferSize;
+    bool           useDriverThread;
+    volatile bool  freewheel;
+    uint64_t       frameTime;
+
+    pthread_t     driverThread;
+    bool          driverRunning;
+    volatile bool driverQuit;
+
+    FakeJackEngine()
+        : sampleRate(48000),
+          bufferSize(256),
+          midiBufferSize(kFakeDefaultMidiSize),
+          useDriverThread(true),
+          freewheel(false),
+          frameTime(0),
+          driverRunning(false),
+          driverQuit(false)
+    {
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+        pthread_mutex_init(&mutex, &attr);
+        pthread_mutexattr_destroy(&attr);
+    }
+
+    ~FakeJackEngine()
+    {
+        stopDriver();
+        pthread_mutex_destroy(&mutex);
+    }
+
+    // must be called with mutex locked
+    void runCycle()
+    {
+        // input buffers are rebuilt on demand, once per cycle
+        for (size_t i=0, count=ports.size(); i < count; ++i)
+        {
+            jack_port_t* const port(ports[i]);
+
+            if (port == nullptr || (port->flags & JackPortIsInput) == 0)
+                continue;
+
+            if (port->midiBuffer != nullptr)
+                port->midiBuffer->nframes = 0; // marks as stale
+        }
+
+        for (size_t i=0, count=clients.size(); i < count; ++i)
+        {
+            jack_client_t* const client(clients[i]);
+
+            if (client->active && client->processCallback != nullptr)
+                client->processCallback(bufferSize, client->processArg);
+        }
+
+        frameTime += bufferSize;
+    }
+
+    void startDriver()
+    {
+        if (driverRunning || ! useDriverThread)
+            return;
+
+        driverQuit    = false;
+        driverRunning = (pthread_create(&driverThread, nullptr, _driver, this) == 0);
+    }
+
+    void stopDriver()
+    {
+        if (! driverRunning)
+            return;
+
+        driverQuit = true;
+        pthread_join(driverThread, nullptr);
+        driverRunning = false;
+    }
+
+    static void* _driver(void* const ptr)
+    {
+        FakeJackEngine* const self((FakeJackEngine*)ptr);
+
+        timespec next;
+        clock_gettime(CLOCK_MONOTONIC, &next);
+
+        while (! self->driverQuit)
+        {
+            pthread_mutex_lock(&self->mutex);
+            const uint64_t periodNs(uint64_t(self->bufferSize) * 1000000000ULL / self->sampleRate);
+            self->runCycle();
+            pthread_mutex_unlock(&self->mutex);
+
+            // freewheel runs as fast as possible, like in JACK
+            if (self->freewheel)
+            {
+                clock_gettime(CLOCK_MONOTONIC, &next);
+                continue;
+            }
+
+            next.tv_nsec += long(periodNs % 1000000000ULL);
+            next.tv_sec  += time_t(periodNs / 1000000000ULL);
+
+            if (next.tv_nsec >= 1000000000L)
+            {
+                next.tv_nsec -= 1000000000L;
+                next.tv_sec  += 1;
+            }
+
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr);
+        }
+
+        return nullptr;
+    }
+};
+
+static FakeJackEngine gFakeEngine;
+
+// -----------------------------------------------------------------------------
+// Fake engine helpers, called with the engine mutex locked
+
+static jack_port_t* fake_port_by_name(const char* const name)
+{
+    for (size_t i=0, count=gFakeEngine.ports.size(); i < count; ++i)
+    {
+        jack_port_t* const port(gFakeEngine.ports[i]);
+
+        if (port != nullptr && std::strcmp(port->name, name) == 0)
+            return port;
+    }
+
+    return nullptr;
+}
+
+static bool fake_port_has_connection(const jack_port_t* const port, const jack_port_t* const other)
+{
+    for (size_t i=0, count=port->connections.size(); i < count; ++i)
+    {
+        if (port->connections[i] == other)
+            return true;
+    }
+
+    return false;
+}
+
+static void fake_port_remove_connection(jack_port_t* const port, const jack_port_t* const other)
+{
+    for (std::vector<jack_port_t*>::iterator it = port->connections.begin(); it != port->connections.end(); ++it)
+    {
+        if (*it != other)
+            continue;
+
+        port->connections.erase(it);
+        return;
+    }
+}
+
+static void fake_notify_connect(const jack_port_t* const a, const jack_port_t* const b, const int connect)
+{
+    for (size_t i=0, count=gFakeEngine.clients.size(); i < count; ++i)
+    {
+        jack_client_t* const client(gFakeEngine.clients[i]);
+
+        if (client->connectCallback != nullptr)
+            client->connectCallback(a->id, b->id, connect, client->connectArg);
+    }
+}
+
+static void fake_disconnect_all(jack_port_t* const port)
+{
+    while (port->connections.size() > 0)
+    {
+        jack_port_t* const other(port->connections.back());
+        port->connections.pop_back();
+        fake_port_remove_connection(other, port);
+
+        if (port->flags & JackPortIsOutput)
+            fake_notify_connect(port, other, 0);
+        else
+            fake_notify_connect(other, port, 0);
+    }
+}
+
+static void fake_free_port(jack_port_t* const port)
+{
+    gFakeEngine.ports[port->id] = nullptr;
+
+    delete[] port->audioBuffer;
+    delete port->midiBuffer;
+    delete port;
+}
+
+static const char** fake_port_connection_names(const jack_port_t* const port)
+{
+    const size_t count(port->connections.size());
+
+    if (count == 0)
+        return nullptr;
+
+    const char** const names((const char**)std::malloc(sizeof(const char*)*(count+1)));
+
+    for (size_t i=0; i < count; ++i)
+        names[i] = port->connections[i]->name;
+
+    names[count] = nullptr;
+    return names;
+}
+
+// -----------------------------------------------------------------------------
+// Fake engine control
+
+void jackbridge_fake_set_engine(jack_nframes_t sample_rate, jack_nframes_t buffer_size, bool use_driver_thread)
+{
+    pthread_mutex_lock(&gFakeEngine.mutex);
+
+    if (sample_rate > 0)
+        gFakeEngine.sampleRate = sample_rate;
+    if (buffer_size > 0 && buffer_size <= kFakeMaxBufferSize)
+        gFakeEngine.bufferSize = buffer_size;
+
+    gFakeEngine.useDriverThread = use_driver_thread;
+
+    pthread_mutex_unlock(&gFakeEngine.mutex);
+
+    if (! use_driver_thread)
+        gFakeEngine.stopDriver();
+}
+
+void jackbridge_fake_set_midi_buffer_size(size_t size)
+{
+    pthread_mutex_lock(&gFakeEngine.mutex);
+    gFakeEngine.midiBufferSize = size;
+    pthread_mutex_unlock(&gFakeEngine.mutex);
+}
+
+void jackbridge_fake_run_cycles(uint32_t cycles)
+{
+    for (uint32_t i=0; i < cycles; ++i)
+    {
+        pthread_mutex_lock(&gFakeEngine.mutex);
+        gFakeEngine.runCycle();
+        pthread_mutex_unlock(&gFakeEngine.mutex);
+    }
+}
+
+uint32_t jackbridge_fake_midi_lost_count(void* port_buffer)
+{
+    return (port_buffer != nullptr) ? ((FakeMidiBuffer*)port_buffer)->lost : 0;
+}
+
+// -----------------------------------------------------------------------------
+
+void jackbridge_get_version(int* major_ptr, int* minor_ptr, int* micro_ptr, int* proto_ptr)
+{
+    if (major_ptr != nullptr)
+        *major_ptr = 0;
+    if (minor_ptr != nullptr)
+        *minor_ptr = 0;
+    if (micro_ptr != nullptr)
+        *micro_ptr = 0;
+    if (proto_ptr != nullptr)
+        *proto_ptr = 0;
+}
+
+const char* jackbridge_get_version_string()
+{
+    return "fake";
+}
+
+// -----------------------------------------------------------------------------
+
+jack_client_t* jackbridge_client_open(const char* client_name, jack_options_t, jack_status_t* status, ...)
+{
+    if (status != nullptr)
+        *status = jack_status_t(0);
+
+    jack_client_t* const client(new jack_client_t);
+    std::snprintf(client->name, kFakeNameSize/2, "%s", client_name);
+
+    client->active             = false;
+    client->processCallback    = nullptr;
+    client->processArg         = nullptr;
+    client->connectCallback    = nullptr;
+    client->connectArg         = nullptr;
+    client->freewheelCallback  = nullptr;
+    client->freewheelArg       = nullptr;
+    client->bufferSizeCallback = nullptr;
+    client->bufferSizeArg      = nullptr;
+    client->sampleRateCallback = nullptr;
+    client->sampleRateArg      = nullptr;
+
+    return client;
+}
+
+bool jackbridge_client_close(jack_client_t* client)
+{
+    if (client == nullptr)
+        return false;
+
+    jackbridge_deactivate(client);
+
+    pthread_mutex_lock(&gFakeEngine.mutex);
+
+    for (size_t i=0, count=client->ports.size(); i < count; ++i)
+    {
+        fake_disconnect_all(client->ports[i]);
+        fake_free_port(client->ports[i]);
+    }
+
+    pthread_mutex_unlock(&gFakeEngine.mutex);
+
+    delete client;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+
+int jackbridge_client_name_size()
+{
+    return kFakeNameSize/2;
+}
+
+char* jackbridge_get_client_name(jack_client_t* client)
+{
+    return (client != nullptr) ? client->name : nullptr;
+}
+
+// -----------------------------------------------------------------------------
+
+bool jackbridge_activate(jack_client_t* client)
+{
+    if (client == nullptr)
+        return false;
+
+    pthread_mutex_lock(&gFakeEngine.mutex);
+
+    if (! client->active)
+    {
+        client->active = true;
+        gFakeEngine.clients.push_back(client);
+    }
+
+    pthread_mutex_unlock(&gFakeEngine.mutex);
+
+    gFakeEngine.startDriver();
+    return true;
+}
+
+bool jackbridge_deactivate(jack_client_t* client)
+{
+    if (client == nullptr)
+        return false;
+
+    pthread_mutex_lock(&gFakeEngine.mutex);
+
+    if (client->active)
+    {
+        client->active = false;
+
+        for (std::vector<jack_client_t*>::iterator it = gFakeEngine.clients.begin(); it != gFakeEngine.clients.end(); ++it)
+        {
+            if (*it != client)
+                continue;
+
+            gFakeEngine.clients.erase(it);
+            break;
+        }
+    }
+
+    const bool lastClient(gFakeEngine.clients.size() == 0);
+
+    pthread_mutex_unlock(&gFakeEngine.mutex);
+
+    if (lastClient)
+        gFakeEngine.stopDriver();
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+
+int jackbridge_get_client_pid(const char*)
+{
+    return 0;
+}
+
+bool jackbridge_is_realtime(jack_client_t*)
+{
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+
+bool jackbridge_set_thread_init_callback(jack_client_t*, JackThreadInitCallback, void*)
+{
+    return false;
+}
+
+void jackbridge_on_shutdown(jack_client_t*, JackShutdownCallback, void*)
+{
+}
+
+void jackbridge_on_info_shutdown(jack_client_t*, JackInfoShutdownCallback, void*)
+{
+}
+
+bool jackbridge_set_process_callback(jack_client_t* client, JackProcessCallback process_callback, void* arg)
+{
+    if (client == nullptr || client->active)
+        return false;
+
+    client->processCallback = process_callback;
+    client->processArg      = arg;
+    return true;
+}
+
+bool jackbridge_set_freewheel_callback(jack_client_t* client, JackFreewheelCallback freewheel_callback, void* arg)
+{
+    if (client == nullptr || client->active)
+        return false;
+
+    client->freewheelCallback = freewheel_callback;
+    client->freewheelArg      = arg;
+    return true;
+}
+
+bool jackbridge_set_buffer_size_callback(jack_client_t* client, JackBufferSizeCallback bufsize_callback, void* arg)
+{
+    if (client == nullptr || client->active)
+        return false;
+
+    client->bufferSizeCallback = bufsize_callback;
+    client->bufferSizeArg      = arg;
+    return true;
+}
+
+bool jackbridge_set_sample_rate_callback(jack_client_t* client, JackSampleRateCallback srate_callback, void* arg)
+{
+    if (client == nullptr || client->active)
+        return false;
+
+    client->sampleRateCallback = srate_callback;
+    client->sampleRateArg      = arg;
+    return true;
+}
+
+bool jackbridge_set_client_registration_callback(jack_client_t*, JackClientRegistrationCallback, void*)
+{
+    return false;
+}
+
+bool jackbridge_set_port_registration_callback(jack_client_t*, JackPortRegistrationCallback, void*)
+{
+    return false;
+}
+
+bool jackbridge_set_port_connect_callback(jack_client_t* client, JackPortConnectCallback connect_callback, void* arg)
+{
+    if (client == nullptr || client->active)
+        return false;
+
+    client->connectCallback = connect_callback;
+    client->connectArg      = arg;
+    return true;
+}
+
+bool jackbridge_set_port_rename_callback(jack_client_t*, JackPortRenameCallback, void*)
+{
+    return false;
+}
+
+bool jackbridge_set_graph_order_callback(jack_client_t*, JackGraphOrderCallback, void*)
+{
+    return false;
+}
+
+bool jackbridge_set_xrun_callback(jack_client_t*, JackXRunCallback, void*)
+{
+    return false;
+}
+
+bool jackbridge_set_latency_callback(jack_client_t*, JackLatencyCallback, void*)
+{
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+
+bool jackbridge_set_freewheel(jack_client_t*, bool onoff)
+{
+    pthread_mutex_lock(&gFakeEngine.mutex);
+
+    if (gFakeEngine.freewheel != onoff)
+    {
+        gFakeEngine.freewheel = onoff;
+
+        for (size_t i=0, count=gFakeEngine.clients.size(); i < count; ++i)
+        {
+            jack_client_t* const client(gFakeEngine.clients[i]);
+
+            if (client->freewheelCallback != nullptr)
+                client->freewheelCallback(onoff ? 1 : 0, client->freewheelArg);
+        }
+    }
+
+    pthread_mutex_unlock(&gFakeEngine.mutex);
+    return true;
+}
+
+bool jackbridge_set_buffer_size(jack_client_t*, jack_nframes_t nframes)
+{
+    if (nframes == 0 || nframes > kFakeMaxBufferSize)
+        return false;
+
+    pthread_mutex_lock(&gFakeEngine.mutex);
+
+    gFakeEngine.bufferSize = nframes;
+
+    for (size_t i=0, count=gFakeEngine.clients.size(); i < count; ++i)
+    {
+        jack_client_t* const client(gFakeEngine.clients[i]);
+
+        if (client->bufferSizeCallback != nullptr)
+            client->bufferSizeCallback(nframes, client->bufferSizeArg);
+    }
+
+    pthread_mutex_unlock(&gFakeEngine.mutex);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+
+jack_nframes_t jackbridge_get_sample_rate(jack_client_t*)
+{
+    return gFakeEngine.sampleRate;
+}
+
+jack_nframes_t jackbridge_get_buffer_size(jack_client_t*)
+{
+    return gFakeEngine.bufferSize;
+}
+
+float jackbridge_cpu_load(jack_client_t*)
+{
+    return 0.0f;
+}
+
+// no wall clock here, the current time is the start of the running (or next) cycle
+jack_nframes_t jackbridge_frame_time(const jack_client_t*)
+{
+    return jack_nframes_t(gFakeEngine.frameTime);
+}
+
+jack_nframes_t jackbridge_last_frame_time(const jack_client_t*)
+{
+    return jack_nframes_t(gFakeEngine.frameTime);
+}
+
+// -----------------------------------------------------------------------------
+
+jack_port_t* jackbridge_port_register(jack_client_t* client, const char* port_name, const char* port_type, unsigned long flags, unsigned long)
+{
+    if (client == nullptr || port_name == nullptr || port_type == nullptr)
+        return nullptr;
+
+    const bool isMidi(std::strcmp(port_type, JACK_DEFAULT_MIDI_TYPE) == 0);
+
+    if (! isMidi && std::strcmp(port_type, JACK_DEFAULT_AUDIO_TYPE) != 0)
+        return nullptr;
+
+    pthread_mutex_lock(&gFakeEngine.mutex);
+
+    char fullName[kFakeNameSize];
+    std::snprintf(fullName, kFakeNameSize, "%.127s:%.127s", client->name, port_name);
+    fullName[kFakeNameSize-1] = '\0';
+
+    if (fake_port_by_name(fullName) != nullptr)
+    {
+        pthread_mutex_unlock(&gFakeEngine.mutex);
+        return nullptr;
+    }
+
+    jack_port_t* const port(new jack_port_t);
+    std::memcpy(port->name, fullName, kFakeNameSize);
+
+    port->id          = jack_port_id_t(gFakeEngine.ports.size());
+    port->client      = client;
+    port->shortName   = port->name + std::strlen(client->name) + 1;
+    port->isMidi      = isMidi;
+    port->flags       = flags;
+    port->audioBuffer = nullptr;
+    port->midiBuffer  = nullptr;
+
+    if (isMidi)
+    {
+        port->midiBuffer = new FakeMidiBuffer(gFakeEngine.midiBufferSize);
+    }
+    else
+    {
+        port->audioBuffer = new float[kFakeMaxBufferSize];
+        std::memset(port->audioBuffer, 0, sizeof(float)*kFakeMaxBufferSize);
+    }
+
+    gFakeEngine.ports.push_back(port);
+    client->ports.push_back(port);
+
+    pthread_mutex_unlock(&gFakeEngine.mutex);
+    return port;
+}
+
+bool jackbridge_port_unregister(jack_client_t* client, jack_port_t* port)
+{
+    if (client == nullptr || port == nullptr || port->client != client)
+        return false;
+
+    pthread_mutex_lock(&gFakeEngine.mutex);
+
+    fake_disconnect_all(port);
+
+    for (std::vector<jack_port_t*>::iterator it = client->ports.begin(); it != client->ports.end(); ++it)
+    {
+        if (*it != port)
+            continue;
+
+        client->ports.erase(it);
+        break;
+    }
+
+    fake_free_port(port);
+
+    pthread_mutex_unlock(&gFakeEngine.mutex);
+    return true;
+}
+
+void* jackbridge_port_get_buffer(jack_port_t* port, jack_nframes_t nframes)
+{
+    if (port == nullptr || nframes > kFakeMaxBufferSize)
+        return nullptr;
+
+    if ((port->flags & JackPortIsInput) == 0)
+    {
+        if (port->midiBuffer != nullptr)
+        {
+            port->midiBuffer->nframes = nframes;
+            return port->midiBuffer;
+        }
+
+        return port->audioBuffer;
+    }
+
+    // input ports mix whatever the connected outputs wrote this cycle
+    if (port->isMidi)
+    {
+        FakeMidiBuffer* const buffer(port->midiBuffer);
+
+        if (buffer->nframes == nframes)
+            return buffer;
+
+        buffer->clear();
+        buffer->nframes = nframes;
+
+        const size_t connCount(port->connections.size());
+        std::vector<uint32_t> positions(connCount, 0);
+
+        for (;;)
+        {
+            FakeMidiBuffer* next = nullptr;
+            size_t nextIndex = 0;
+
+            for (size_t i=0; i < connCount; ++i)
+            {
+                FakeMidiBuffer* const src(port->connections[i]->midiBuffer);
+
+                if (positions[i] >= src->count)
+                    continue;
+
+                if (next == nullptr || src->events[positions[i]].time < next->events[positions[nextIndex]].time)
+                {
+                    next      = src;
+                    nextIndex = i;
+                }
+            }
+
+            if (next == nullptr)
+                break;
+
+            const FakeMidiEvent& event(next->events[positions[nextIndex]++]);
+
+            if (jack_midi_data_t* const data = buffer->reserve(event.time, event.size))
+                std::memcpy(data, next->data + event.offset, event.size);
+        }
+
+        return buffer;
+    }
+
+    float* const buffer(port->audioBuffer);
+    std::memset(buffer, 0, sizeof(float)*nframes);
+
+    for (size_t i=0, count=port->connections.size(); i < count; ++i)
+    {
+        const float* const src(port->connections[i]->audioBuffer);
+
+        for (jack_nframes_t j=0; j < nframes; ++j)
+            buffer[j] += src[j];
+    }
+
+    return buffer;
+}
+
+// -----------------------------------------------------------------------------
+
+const char* jackbridge_port_name(const jack_port_t* port)
+{
+    return (port != nullptr) ? port->name : nullptr;
+}
+
+const char* jackbridge_port_short_name(const jack_port_t* port)
+{
+    return (port != nullptr) ? port->shortName : nullptr;
+}
+
+int jackbridge_port_flags(const jack_port_t* port)
+{
+    return (port != nullptr) ? int(port->flags) : 0;
+}
+
+const char* jackbridge_port_type(const jack_port_t* port)
+{
+    if (port == nullptr)
+        return nullptr;
+
+    return port->isMidi ? JACK_DEFAULT_MIDI_TYPE : JACK_DEFAULT_AUDIO_TYPE;
+}
+
+bool jackbridge_port_is_mine(const jack_client_t* client, const jack_port_t* port)
+{
+    return (port != nullptr && client != nullptr && port->client == client);
+}
+
+bool jackbridge_port_connected(const jack_port_t* port)
+{
+    if (port == nullptr)
+        return false;
+
+    pthread_mutex_lock(&gFakeEngine.mutex);
+    const bool connected(port->connections.size() > 0);
+    pthread_mutex_unlock(&gFakeEngine.mutex);
+
+    return connected;
+}
+
+bool jackbridge_port_connected_to(const jack_port_t* port, const char* port_name)
+{
+    if (port == nullptr || port_name == nullptr)
+        return false;
+
+    pthread_mutex_lock(&gFakeEngine.mutex);
+    const jack_port_t* const other(fake_port_by_name(port_name));
+    const bool connected(other != nullptr && fake_port_has_connection(port, other));
+    pthread_mutex_unlock(&gFakeEngine.mutex);
+
+    return connected;
+}
+
+const char** jackbridge_port_get_connections(const jack_port_t* port)
+{
+    if (port == nullptr)
+        return nullptr;
+
+    pthread_mutex_lock(&gFakeEngine.mutex);
+    const char** const names(fake_port_connection_names(port));
+    pthread_mutex_unlock(&gFakeEngine.mutex);
+
+    return names;
+}
+
+const char** jackbridge_port_get_all_connections(const jack_client_t*, const jack_port_t* port)
+{
+    return jackbridge_port_get_connections(port);
+}
+
+// -----------------------------------------------------------------------------
+
+bool jackbridge_port_set_name(jack_port_t* port, const char* port_name)
+{
+    if (port == nullptr || port_name == nullptr || port_name[0] == '\0')
+        return false;
+
+    pthread_mutex_lock(&gFakeEngine.mutex);
+
+    char fullName[kFakeNameSize];
+    std::snprintf(fullName, kFakeNameSize, "%.127s:%.127s", port->client->name, port_name);
+    fullName[kFakeNameSize-1] = '\0';
+
+    const jack_port_t* const other(fake_port_by_name(fullName));
+
+    if (other != nullptr && other != port)
+    {
+        pthread_mutex_unlock(&gFakeEngine.mutex);
+        return false;
+    }
+
+    // shortName points inside name, the client part stays the same
+    std::memcpy(port->name, fullName, kFakeNameSize);
+
+    pthread_mutex_unlock(&gFakeEngine.mutex);
+    return true;
+}
+
+bool jackbridge_port_set_alias(jack_port_t*, const char*)
+{
+    return false;
+}
+
+bool jackbridge_port_unset_alias(jack_port_t*, const char*)
+{
+    return false;
+}
+
+int jackbridge_port_get_aliases(const jack_port_t*, char* const aliases[2])
+{
+    if (aliases != nullptr)
+    {
+        if (aliases[0] != nullptr)
+            aliases[0][0] = '\0';
+        if (aliases[1] != nullptr)
+            aliases[1][0] = '\0';
+    }
+
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+
+bool jackbridge_port_request_monitor(jack_port_t*, bool)
+{
+    return false;
+}
+
+bool jackbridge_port_request_monitor_by_name(jack_client_t*, const char*, bool)
+{
+    return false;
+}
+
+bool jackbridge_port_ensure_monitor(jack_port_t*, bool)
+{
+    return false;
+}
+
+bool jackbridge_port_monitoring_input(jack_port_t*)
+{
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+
+bool jackbridge_connect(jack_client_t*, const char* source_port, const char* destination_port)
+{
+    if (source_port == nullptr || destination_port == nullptr)
+        return false;
+
+    pthread_mutex_lock(&gFakeEngine.mutex);
+
+    jack_port_t* const src(fake_port_by_name(source_port));
+    jack_port_t* const dst(fake_port_by_name(destination_port));
+
+    if (src == nullptr || dst == nullptr || src->isMidi != dst->isMidi ||
+        (src->flags & JackPortIsOutput) == 0 || (dst->flags & JackPortIsInput) == 0 ||
+        fake_port_has_connection(src, dst))
+    {
+        pthread_mutex_unlock(&gFakeEngine.mutex);
+        return false;
+    }
+
+    src->connections.push_back(dst);
+    dst->connections.push_back(src);
+
+    fake_notify_connect(src, dst, 1);
+
+    pthread_mutex_unlock(&gFakeEngine.mutex);
+    return true;
+}
+
+bool jackbridge_disconnect(jack_client_t*, const char* source_port, const char* destination_port)
+{
+    if (source_port == nullptr || destination_port == nullptr)
+        return false;
+
+    pthread_mutex_lock(&gFakeEngine.mutex);
+
+    jack_port_t* const src(fake_port_by_name(source_port));
+    jack_port_t* const dst(fake_port_by_name(destination_port));
+
+    if (src == nullptr || dst == nullptr || ! fake_port_has_connection(src, dst))
+    {
+        pthread_mutex_unlock(&gFakeEngine.mutex);
+        return false;
+    }
+
+    fake_port_remove_connection(src, dst);
+    fake_port_remove_connection(dst, src);
+
+    fake_notify_connect(src, dst, 0);
+
+    pthread_mutex_unlock(&gFakeEngine.mutex);
+    return true;
+}
+
+bool jackbridge_port_disconnect(jack_client_t*, jack_port_t* port)
+{
+    if (port == nullptr)
+        return false;
+
+    pthread_mutex_lock(&gFakeEngine.mutex);
+    fake_disconnect_all(port);
+    pthread_mutex_unlock(&gFakeEngine.mutex);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+
+int jackbridge_port_name_size()
+{
+    return kFakeNameSize;
+}
+
+int jackbridge_port_type_size()
+{
+    return 32;
+}
+
+size_t jackbridge_port_type_get_buffer_size(jack_client_t*, const char* port_type)
+{
+    if (port_type != nullptr && std::strcmp(port_type, JACK_DEFAULT_MIDI_TYPE) == 0)
+        return gFakeEngine.midiBufferSize;
+
+    return gFakeEngine.bufferSize*sizeof(float);
+}
+
+// -----------------------------------------------------------------------------
+
+void jackbridge_port_get_latency_range(jack_port_t*, jack_latency_callback_mode_t, jack_latency_range_t* range)
+{
+    if (range == nullptr)
+        return;
+
+    range->min = 0;
+    range->max = 0;
+}
+
+void jackbridge_port_set_latency_range(jack_port_t*, jack_latency_callback_mode_t, jack_latency_range_t*)
+{
+}
+
+bool jackbridge_recompute_total_latencies(jack_client_t*)
+{
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+
+// patterns are plain substrings here, not regular expressions like in JACK
+const char** jackbridge_get_ports(jack_client_t*, const char* port_name_pattern, const char* type_name_pattern, unsigned long flags)
+{
+    pthread_mutex_lock(&gFakeEngine.mutex);
+
+    std::vector<const char*> names;
+
+    for (size_t i=0, count=gFakeEngine.ports.size(); i < count; ++i)
+    {
+        const jack_port_t* const port(gFakeEngine.ports[i]);
+
+        if (port == nullptr)
+            continue;
+        if (flags != 0 && (port->flags & flags) != flags)
+            continue;
+        if (port_name_pattern != nullptr && port_name_pattern[0] != '\0' && std::strstr(port->name, port_name_pattern) == nullptr)
+            continue;
+        if (type_name_pattern != nullptr && type_name_pattern[0] != '\0' && std::strstr(jackbridge_port_type(port), type_name_pattern) == nullptr)
+            continue;
+
+        names.push_back(port->name);
+    }
+
+    const char** ret = nullptr;
+
+    if (names.size() > 0)
+    {
+        ret = (const char**)std::malloc(sizeof(const char*)*(names.size()+1));
+
+        for (size_t i=0, count=names.size(); i < count; ++i)
+            ret[i] = names[i];
+
+        ret[names.size()] = nullptr;
+    }
+
+    pthread_mutex_unlock(&gFakeEngine.mutex);
+    return ret;
+}
+
+jack_port_t* jackbridge_port_by_name(jack_client_t*, const char* port_name)
+{
+    if (port_name == nullptr)
+        return nullptr;
+
+    pthread_mutex_lock(&gFakeEngine.mutex);
+    jack_port_t* const port(fake_port_by_name(port_name));
+    pthread_mutex_unlock(&gFakeEngine.mutex);
+
+    return port;
+}
+
+jack_port_t* jackbridge_port_by_id(jack_client_t*, jack_port_id_t port_id)
+{
+    pthread_mutex_lock(&gFakeEngine.mutex);
+    jack_port_t* const port((port_id < gFakeEngine.ports.size()) ? gFakeEngine.ports[port_id] : nullptr);
+    pthread_mutex_unlock(&gFakeEngine.mutex);
+
+    return port;
+}
+
+// -----------------------------------------------------------------------------
+
+void jackbridge_free(void* ptr)
+{
+    std::free(ptr);
+}
+
+// -----------------------------------------------------------------------------
+
+uint32_t jackbridge_midi_get_event_count(void* port_buffer)
+{
+    return (port_buffer != nullptr) ? ((FakeMidiBuffer*)port_buffer)->count : 0;
+}
+
+bool jackbridge_midi_event_get(jack_midi_event_t* event, void* port_buffer, uint32_t event_index)
+{
+    FakeMidiBuffer* const buffer((FakeMidiBuffer*)port_buffer);
+
+    if (event == nullptr || buffer == nullptr || event_index >= buffer->count)
+        return false;
+
+    const FakeMidiEvent& fakeEvent(buffer->events[event_index]);
+
+    event->time   = fakeEvent.time;
+    event->size   = fakeEvent.size;
+    event->buffer = buffer->data + fakeEvent.offset;
+    return true;
+}
+
+void jackbridge_midi_clear_buffer(void* port_buffer)
+{
+    if (port_buffer != nullptr)
+        ((FakeMidiBuffer*)port_buffer)->clear();
+}
+
+bool jackbridge_midi_event_write(void* port_buffer, jack_nframes_t time, const jack_midi_data_t* data, size_t data_size)
+{
+    if (jack_midi_data_t* const buffer = jackbridge_midi_event_reserve(port_buffer, time, data_size))
+    {
+        std::memcpy(buffer, data, data_size);
+        return true;
+    }
+
+    return false;
+}
+
+jack_midi_data_t* jackbridge_midi_event_reserve(void* port_buffer, jack_nframes_t time, size_t data_size)
+{
+    return (port_buffer != nullptr) ? ((FakeMidiBuffer*)port_buffer)->reserve(time, data_size) : nullptr;
+}
+
+uint32_t jackbridge_midi_events_write(void* port_buffer, const jack_midi_event_t* events, uint32_t event_count)
+{
+    uint32_t written = 0;
+
+    for (uint32_t i=0; i < event_count; ++i)
+    {
+        if (jackbridge_midi_event_write(port_buffer, events[i].time, events[i].buffer, events[i].size))
+            ++written;
+    }
+
+    return written;
+}
+
+// -----------------------------------------------------------------------------
+// Transport is not simulated, it stays stopped at frame 0
+
+bool jackbridge_release_timebase(jack_client_t*)
+{
+    return false;
+}
+
+bool jackbridge_set_sync_callback(jack_client_t*, JackSyncCallback, void*)
+{
+    return false;
+}
+
+bool jackbridge_set_sync_timeout(jack_client_t*, jack_time_t)
+{
+    return false;
+}
+
+bool jackbridge_set_timebase_callback(jack_client_t*, bool, JackTimebaseCallback, void*)
+{
+    return false;
+}
+
+bool jackbridge_transport_locate(jack_client_t*, jack_nframes_t)
+{
+    return false;
+}
+
+jack_transport_state_t jackbridge_transport_query(const jack_client_t*, jack_position_t* pos)
+{
+    if (pos != nullptr)
+    {
+        std::memset(pos, 0, sizeof(jack_position_t));
+        pos->frame_rate = gFakeEngine.sampleRate;
+    }
+
+    return JackTransportStopped;
+}
+
+jack_nframes_t jackbridge_get_current_transport_frame(const jack_client_t*)
+{
+    return 0;
+}
+
+bool jackbridge_transport_reposition(jack_client_t*, const jack_position_t*)
+{
+    return false;
+}
+
+void jackbridge_transport_start(jack_client_t*)
+{
+}
+
+void jackbridge_transport_stop(jack_client_t*)
+{
+}
+
+// -----------------------------------------------------------------------------
@@ -0,0 +1,156 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// MIDI output through the three JackBridge paths, for 10, 100 and 1000 events per cycle.
+//
+// The fake engine's port buffer stands in for libjack, behind a non-inlined call:
+//  - direct:  one call per event, as the JACKBRIDGE_DIRECT inline wrappers do
+//  - dlopen:  one jackbridge_midi_event_write per event, loading and checking the
+//             resolved symbol every time, as JackBridge.cpp does
+//  - batched: one jackbridge_midi_events_write per cycle, symbol resolved once
+//
+// Reported per cycle: write time and events that made it into the buffer.
+//
+// usage: BenchBridge
+
+#include "JackAssTest.hpp"
+
+static const jack_nframes_t kBufferSize = 256;
+static const int            kCycles     = 20000;
+
+// -----------------------------------------------------------------------------
+// libjack and the dlopen bridge, same shape as jackbridge/JackBridge.cpp
+
+typedef int (*jacksym_midi_event_write)(void*, jack_nframes_t, const jack_midi_data_t*, size_t);
+
+__attribute__((noinline))
+static int lib_midi_event_write(void* port_buffer, jack_nframes_t time, const jack_midi_data_t* data, size_t data_size)
+{
+    return jackbridge_midi_event_write(port_buffer, time, data, data_size) ? 0 : -1;
+}
+
+static struct {
+    jacksym_midi_event_write midi_event_write_ptr;
+} bridge = { nullptr };
+
+__attribute__((noinline))
+static bool bridge_midi_event_write(void* port_buffer, jack_nframes_t time, const jack_midi_data_t* data, size_t data_size)
+{
+    if (bridge.midi_event_write_ptr != nullptr)
+        return (bridge.midi_event_write_ptr(port_buffer, time, data, data_size) == 0);
+    return false;
+}
+
+__attribute__((noinline))
+static uint32_t bridge_midi_events_write(void* port_buffer, const jack_midi_event_t* events, uint32_t event_count)
+{
+    if (const jacksym_midi_event_write write_ptr = bridge.midi_event_write_ptr)
+    {
+        uint32_t written = 0;
+
+        for (uint32_t i=0; i < event_count; ++i)
+        {
+            if (write_ptr(port_buffer, events[i].time, events[i].buffer, events[i].size) == 0)
+                ++written;
+        }
+
+        return written;
+    }
+
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+
+enum Path {
+    kPathDirect,
+    kPathDlopen,
+    kPathBatched
+};
+
+static void run(jack_port_t* const port, const uint32_t eventCount, const Path path)
+{
+    std::vector<jack_midi_data_t>  data(eventCount * 3);
+    std::vector<jack_midi_event_t> events(eventCount);
+
+    for (uint32_t i=0; i < eventCount; ++i)
+    {
+        data[i*3]   = 0xB0;
+        data[i*3+1] = (unsigned char)(i & 0x7f);
+        data[i*3+2] = 0;
+
+        events[i].time   = jack_nframes_t(uint64_t(i) * kBufferSize / eventCount);
+        events[i].size   = 3;
+        events[i].buffer = &data[i*3];
+    }
+
+    double writeTime = 0.0;
+    uint64_t written = 0;
+
+    for (int k=0; k < kCycles; ++k)
+    {
+        void* const portBuffer(jackbridge_port_get_buffer(port, kBufferSize));
+        jackbridge_midi_clear_buffer(portBuffer);
+
+        const double start(benchTime());
+
+        switch (path)
+        {
+        case kPathDirect:
+            for (uint32_t i=0; i < eventCount; ++i)
+                lib_midi_event_write(portBuffer, events[i].time, events[i].buffer, events[i].size);
+            break;
+        case kPathDlopen:
+            for (uint32_t i=0; i < eventCount; ++i)
+                bridge_midi_event_write(portBuffer, events[i].time, events[i].buffer, events[i].size);
+            break;
+        case kPathBatched:
+            bridge_midi_events_write(portBuffer, &events[0], eventCount);
+            break;
+        }
+
+        writeTime += benchTime() - start;
+        written   += jackbridge_midi_get_event_count(portBuffer);
+    }
+
+    static const char* const names[] = { "direct:", "dlopen:", "batched:" };
+
+    std::printf("%4u events, %-9s %8.3f us per cycle, %5.2f ns per event, %llu of %llu written\n",
+                eventCount, names[path], writeTime / kCycles * 1e6, writeTime / kCycles / eventCount * 1e9,
+                (unsigned long long)written, (unsigned long long)eventCount * kCycles);
+}
+
+int main()
+{
+    jackbridge_fake_set_engine(48000, kBufferSize, false);
+
+    bridge.midi_event_write_ptr = lib_midi_event_write;
+
+    jack_client_t* const client(jackbridge_client_open("bench", JackNullOption, nullptr));
+    jack_port_t* const port(jackbridge_port_register(client, "out", JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0));
+
+    static const uint32_t counts[] = { 10, 100, 1000 };
+
+    for (int i=0; i < 3; ++i)
+    {
+        run(port, counts[i], kPathDirect);
+        run(port, counts[i], kPathDlopen);
+        run(port, counts[i], kPathBatched);
+    }
+
+    jackbridge_client_close(client);
+    return 0;
+}
@@ -0,0 +1,103 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// One JACK client per instance (JACKASS_CLIENT_PER_INSTANCE=1) against the shared client,
+// for 1, 16 and 128 instances.
+//
+// Reported per cycle: host side cost (processEvents) and the whole fake JACK cycle,
+// including the receiving client. The fake engine calls every client from one thread,
+// so the context switch a real server makes per client is not part of the numbers;
+// what is left is the JackAss side of each mode.
+//
+// usage: BenchClients [events per instance and cycle, default 8]
+
+#include "JackAssTest.hpp"
+
+static const jack_nframes_t kBufferSize = 256;
+static const int            kCycles     = 2000;
+
+static void run(const int instances, const int events, const bool perInstance)
+{
+    if (perInstance)
+        setenv("JACKASS_CLIENT_PER_INSTANCE", "1", 1);
+
+    std::vector<JackAss*> plugins;
+
+    for (int i=0; i < instances; ++i)
+        plugins.push_back(new JackAss(testAudioMaster));
+
+    unsetenv("JACKASS_CLIENT_PER_INSTANCE");
+
+    TestMidiSink sink("sink");
+
+    for (int i=0; i < instances; ++i)
+    {
+        char portName[32];
+        std::snprintf(portName, 32, perInstance ? "JackAss_%02i:midi-out" : "JackAss:midi-out_%02i", i+1);
+        sink.connect(portName);
+    }
+
+    jackbridge_fake_run_cycles(2);
+
+    double hostTime = 0.0, cycleTime = 0.0;
+    size_t received = 0;
+
+    for (int k=0; k < kCycles; ++k)
+    {
+        const double hostStart(benchTime());
+
+        for (size_t i=0; i < plugins.size(); ++i)
+        {
+            for (int j=0; j < events; ++j)
+                testSendMidi(plugins[i], 0xB0, (unsigned char)j, (unsigned char)(k & 0x7f), VstInt32(j * (kBufferSize / events)));
+        }
+
+        hostTime += benchTime() - hostStart;
+
+        sink.events.clear();
+
+        const double cycleStart(benchTime());
+        jackbridge_fake_run_cycles(1);
+        cycleTime += benchTime() - cycleStart;
+
+        received += sink.events.size();
+    }
+
+    std::printf("%3i instances, %-16s host %7.2f us, cycle %7.2f us, %zu of %zu events received\n",
+                instances, perInstance ? "client each:" : "shared client:", hostTime / kCycles * 1e6, cycleTime / kCycles * 1e6,
+                received, size_t(instances) * size_t(events) * kCycles);
+
+    for (size_t i=0; i < plugins.size(); ++i)
+        delete plugins[i];
+}
+
+int main(int argc, char* argv[])
+{
+    const int events((argc > 1) ? std::max(1, std::atoi(argv[1])) : 8);
+
+    jackbridge_fake_set_engine(48000, kBufferSize, false);
+
+    std::printf("%i events per instance and cycle, %u frames\n", events, kBufferSize);
+
+    run(1, events, false);
+    run(1, events, true);
+    run(16, events, false);
+    run(16, events, true);
+    run(128, events, false);
+    run(128, events, true);
+
+    return 0;
+}
@@ -0,0 +1,242 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// Hub against the in-process client, for 16 and 128 instances.
+//
+// Plugins run in hub mode (JACKASS_HUB=<private registry>) or with the shared client, and
+// this process plays the hub too, with the same hub_process_slot() as jackass-hub.
+// Both sides are in one process, so the cost of cache lines moving between processes is
+// not part of the numbers.
+//
+// Reported per cycle: host side cost (processEvents), JACK side cost (hub or instance
+// processing) and how late a note arrives against its block offset.
+//
+// usage: BenchHub [events per instance and cycle, default 8]
+
+#include "JackAssTest.hpp"
+
+#include <sys/stat.h>
+
+static const jack_nframes_t kBufferSize = 256;
+static const int            kCycles     = 2000;
+
+// -------------------------------------------------
+// hub side, like jackass-hub but with the fake engine and without its slot thread
+
+struct BenchHub {
+    char            shmName[32];
+    hub_registry_t* registry;
+    jack_client_t*  client;
+    hub_port_t      ports[kHubMaxSlots];
+
+    BenchHub()
+        : registry(nullptr),
+          client(nullptr)
+    {
+        std::memset(ports, 0, sizeof(ports));
+        std::snprintf(shmName, 32, "/jackass-bench-%i", int(getpid()));
+
+        const int fd(::shm_open(shmName, O_RDWR|O_CREAT|O_EXCL, 0600));
+
+        if (fd < 0 || ::ftruncate(fd, sizeof(hub_registry_t)) != 0)
+            return;
+
+        void* const map(::mmap(nullptr, sizeof(hub_registry_t), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0));
+        ::close(fd);
+
+        if (map == MAP_FAILED)
+            return;
+
+        registry = (hub_registry_t*)map;
+        std::memset(registry, 0, sizeof(hub_registry_t));
+        registry->magic   = kHubMagic;
+        registry->version = kHubVersion;
+        registry->hubPid  = int32_t(getpid());
+
+        client = jackbridge_client_open("JackAss-Hub", JackNullOption, nullptr);
+        jackbridge_set_process_callback(client, _process, this);
+        jackbridge_activate(client);
+    }
+
+    ~BenchHub()
+    {
+        if (client != nullptr)
+            jackbridge_client_close(client);
+
+        if (registry != nullptr)
+        {
+            ::munmap(registry, sizeof(hub_registry_t));
+            ::shm_unlink(shmName);
+        }
+    }
+
+    // what the hub main loop does for new slots
+    void registerRequested(TestMidiSink& sink)
+    {
+        for (int i=0; i < kHubMaxSlots; ++i)
+        {
+            hub_slot_t& slot(registry->slots[i]);
+
+            if (slot.state != kHubSlotRequested)
+                continue;
+
+            ports[i].port  = jackbridge_port_register(client, slot.portName, JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0);
+            slot.state     = kHubSlotActive;
+            slot.connected = 1;
+
+            sink.connect(jackbridge_port_name(ports[i].port));
+        }
+    }
+
+    void process(const jack_nframes_t nframes)
+    {
+        int resendBudget = 64;
+
+        for (int i=0; i < kHubMaxSlots; ++i)
+        {
+            if (ports[i].port != nullptr)
+                hub_process_slot(ports[i], registry->slots[i], nframes, resendBudget);
+        }
+    }
+
+    static int _process(const jack_nframes_t nframes, void* const ptr)
+    {
+        ((BenchHub*)ptr)->process(nframes);
+        return 0;
+    }
+};
+
+// -------------------------------------------------
+
+static void sendBlock(const std::vector<JackAss*>& plugins, const int events, const int cycle)
+{
+    for (size_t i=0; i < plugins.size(); ++i)
+    {
+        for (int j=0; j < events; ++j)
+        {
+            const VstInt32 offset(VstInt32(j * (kBufferSize / events)));
+
+            if (j < 2)
+                testSendMidi(plugins[i], (j == 0) ? 0x90 : 0x80, 60, 100, offset);
+            else
+                testSendMidi(plugins[i], 0xB0, (unsigned char)j, (unsigned char)(cycle & 0x7f), offset);
+        }
+    }
+}
+
+// late frames of a note sent at offset 100 before the next cycle
+static long measureLatency(JackAss* const plugin, TestMidiSink& sink)
+{
+    jackbridge_fake_run_cycles(1);
+    sink.events.clear();
+
+    testSendMidi(plugin, 0x90, 72, 100, 100);
+    jackbridge_fake_run_cycles(1);
+
+    for (size_t i=0; i < sink.events.size(); ++i)
+    {
+        if (sink.events[i].data[0] == 0x90 && sink.events[i].data[1] == 72)
+            return long(sink.events[i].frame % kBufferSize) - 100;
+    }
+
+    return -1;
+}
+
+static void run(const int instances, const int events, const bool useHub)
+{
+    BenchHub* const hub(useHub ? new BenchHub() : nullptr);
+
+    if (useHub)
+    {
+        if (hub->registry == nullptr)
+        {
+            std::printf("failed to create the hub registry\n");
+            delete hub;
+            return;
+        }
+
+        setenv("JACKASS_HUB", hub->shmName, 1);
+    }
+
+    std::vector<JackAss*> plugins;
+
+    for (int i=0; i < instances; ++i)
+        plugins.push_back(new JackAss(testAudioMaster));
+
+    unsetenv("JACKASS_HUB");
+
+    TestMidiSink sink("sink");
+
+    if (useHub)
+    {
+        hub->registerRequested(sink);
+    }
+    else
+    {
+        for (int i=0; i < instances; ++i)
+        {
+            char portName[32];
+            std::snprintf(portName, 32, "JackAss:midi-out_%02i", i+1);
+            sink.connect(portName);
+        }
+    }
+
+    jackbridge_fake_run_cycles(2);
+
+    double hostTime = 0.0, jackTime = 0.0;
+    jack_nframes_t nframes(kBufferSize);
+
+    for (int k=0; k < kCycles; ++k)
+    {
+        const double start(benchTime());
+        sendBlock(plugins, events, k);
+        const double middle(benchTime());
+
+        if (useHub)
+            hub->process(nframes);
+        else
+            jprocess_callback(nframes, nullptr);
+
+        jackTime += benchTime() - middle;
+        hostTime += middle - start;
+    }
+
+    const long late(measureLatency(plugins[0], sink));
+
+    std::printf("%3i instances, %-10s host %7.2f us, JACK %7.2f us per cycle, note %li frames late\n",
+                instances, useHub ? "hub:" : "in-process:", hostTime / kCycles * 1e6, jackTime / kCycles * 1e6, late);
+
+    for (size_t i=0; i < plugins.size(); ++i)
+        delete plugins[i];
+
+    delete hub;
+}
+
+int main(int argc, char* argv[])
+{
+    const int events((argc > 1) ? std::atoi(argv[1]) : 8);
+
+    jackbridge_fake_set_engine(48000, kBufferSize, false);
+
+    std::printf("%i events per instance and cycle, %u frames\n", events, kBufferSize);
+
+    run(16, events, false);
+    run(16, events, true);
+    run(128, events, false);
+    run(128, events, true);
+
+    return 0;
+}
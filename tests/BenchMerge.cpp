@@ -0,0 +1,104 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// Merge mode (JACKASS_MERGE=16) against one port per instance, for 16 and 128 instances.
+//
+// Reported per cycle: JackAss process callback time, and the whole fake JACK cycle
+// including the receiving client, which reads one port per group instead of one per instance.
+//
+// usage: BenchMerge [events per instance and cycle, default 8]
+
+#include "JackAssTest.hpp"
+
+static const jack_nframes_t kBufferSize = 256;
+static const int            kCycles     = 2000;
+
+static void run(const int instances, const int events, const bool merge)
+{
+    if (merge)
+        setenv("JACKASS_MERGE", "16", 1);
+
+    std::vector<JackAss*> plugins;
+
+    for (int i=0; i < instances; ++i)
+        plugins.push_back(new JackAss(testAudioMaster));
+
+    unsetenv("JACKASS_MERGE");
+
+    TestMidiSink sink("sink");
+    const int ports(merge ? (instances + 15) / 16 : instances);
+
+    for (int i=0; i < ports; ++i)
+    {
+        char portName[32];
+        std::snprintf(portName, 32, merge ? "JackAss:midi-merge_%02i" : "JackAss:midi-out_%02i", i+1);
+        sink.connect(portName);
+    }
+
+    jackbridge_fake_run_cycles(2);
+
+    double processTime = 0.0, cycleTime = 0.0;
+    jack_nframes_t nframes(kBufferSize);
+
+    for (int k=0; k < kCycles; ++k)
+    {
+        for (size_t i=0; i < plugins.size(); ++i)
+        {
+            for (int j=0; j < events; ++j)
+                testSendMidi(plugins[i], 0xB0, (unsigned char)j, (unsigned char)(k & 0x7f), VstInt32(j * (kBufferSize / events)));
+        }
+
+        // same events twice, once for the callback alone and once for a full cycle
+        const double start(benchTime());
+        jprocess_callback(nframes, nullptr);
+        processTime += benchTime() - start;
+
+        for (size_t i=0; i < plugins.size(); ++i)
+        {
+            for (int j=0; j < events; ++j)
+                testSendMidi(plugins[i], 0xB0, (unsigned char)j, (unsigned char)(k & 0x7f), VstInt32(j * (kBufferSize / events)));
+        }
+
+        sink.events.clear();
+
+        const double cycleStart(benchTime());
+        jackbridge_fake_run_cycles(1);
+        cycleTime += benchTime() - cycleStart;
+    }
+
+    std::printf("%3i instances, %-14s %3i ports, process %7.2f us, cycle %7.2f us, %zu events received\n",
+                instances, merge ? "merge:" : "port each:", ports, processTime / kCycles * 1e6, cycleTime / kCycles * 1e6,
+                sink.events.size());
+
+    for (size_t i=0; i < plugins.size(); ++i)
+        delete plugins[i];
+}
+
+int main(int argc, char* argv[])
+{
+    const int events((argc > 1) ? std::atoi(argv[1]) : 8);
+
+    jackbridge_fake_set_engine(48000, kBufferSize, false);
+
+    std::printf("%i events per instance and cycle, %u frames\n", events, kBufferSize);
+
+    run(16, events, false);
+    run(16, events, true);
+    run(128, events, false);
+    run(128, events, true);
+
+    return 0;
+}
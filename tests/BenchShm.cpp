@@ -0,0 +1,169 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// Shared memory ring between two processes, the plugin side writing and a forked reader
+// sleeping in wait() like a real consumer.
+//
+// Latency: single events 1ms apart, from write() to the reader having it, stamped with
+// CLOCK_MONOTONIC in the event frame.
+// Throughput: events written back to back, the writer yielding when the ring is full,
+// so the rate is what reaches the reader. Full ring counts how often the writer waited.
+//
+// usage: BenchShm [events in the throughput run, default 1000000]
+
+#include "JackAssTest.hpp"
+
+#include <sched.h>
+#include <sys/wait.h>
+
+#ifndef JACKASS_SHM_UNSUPPORTED
+static const int kPings = 1000;
+
+enum BenchPhase {
+    kPhasePing  = 0,
+    kPhaseBurst = 1,
+    kPhaseEnd   = 2
+};
+
+static uint64_t benchTimeNs()
+{
+    return uint64_t(benchTime() * 1e9);
+}
+
+static int runReader(const char* const name)
+{
+    JackAssShmReader reader;
+
+    if (! reader.open(name))
+        return 1;
+
+    capture_event_t events[256];
+    double latencySum = 0.0, latencyMax = 0.0;
+    int pings = 0, burst = 0;
+
+    for (bool done = false; ! done;)
+    {
+        const uint32_t count(reader.read(events, 256));
+
+        if (count == 0)
+        {
+            reader.wait(1000);
+            continue;
+        }
+
+        const uint64_t now(benchTimeNs());
+
+        for (uint32_t i=0; i < count; ++i)
+        {
+            switch (events[i].data[1])
+            {
+            case kPhasePing: {
+                const double latency(double(now - events[i].frame) / 1000.0);
+
+                latencySum += latency;
+                if (latency > latencyMax)
+                    latencyMax = latency;
+                ++pings;
+                break;
+            }
+            case kPhaseBurst:
+                ++burst;
+                break;
+            default:
+                done = true;
+                break;
+            }
+        }
+    }
+
+    std::printf("latency:    %i events, average %7.2f us, worst %7.2f us\n",
+                pings, pings != 0 ? latencySum / pings : 0.0, latencyMax);
+    std::printf("reader:     %i burst events received\n", burst);
+    std::fflush(stdout);
+    return 0;
+}
+#endif
+
+int main(int argc, char* argv[])
+{
+#ifndef JACKASS_SHM_UNSUPPORTED
+    const int burstCount((argc > 1) ? std::atoi(argv[1]) : 1000000);
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "/jackass-bench-%i", int(::getpid()));
+
+    JackAssShmOutput output;
+
+    if (! output.open(name, 48000))
+    {
+        std::printf("failed to create the ring\n");
+        return 1;
+    }
+
+    const pid_t child(::fork());
+
+    if (child == 0)
+        ::_exit(runReader(name));
+
+    while (! output.isConnected())
+        ::usleep(1000);
+
+    unsigned char data[4] = { 0x90, kPhasePing, 100, 0 };
+
+    for (int i=0; i < kPings; ++i)
+    {
+        output.write(data, 3, 0, benchTimeNs());
+        ::usleep(1000);
+    }
+
+    data[1] = kPhaseBurst;
+
+    int full = 0;
+    const double start(benchTime());
+
+    for (int i=0; i < burstCount; ++i)
+    {
+        while (! output.write(data, 3, 0, 0))
+        {
+            ++full;
+            ::sched_yield();
+        }
+    }
+
+    data[1] = kPhaseEnd;
+
+    while (! output.write(data, 3, 0, 0))
+        ::sched_yield();
+
+    const double elapsed(benchTime() - start);
+
+    std::printf("throughput: %i events in %.3f s, %.2f M events/s, ring full %i times\n",
+                burstCount, elapsed, double(burstCount) / elapsed / 1e6, full);
+    std::fflush(stdout);
+
+    int status = -1;
+    ::waitpid(child, &status, 0);
+    output.close();
+
+    return (WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : 1;
+#else
+    return 0;
+
+    // unused
+    (void)argc;
+    (void)argv;
+#endif
+}
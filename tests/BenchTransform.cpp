@@ -0,0 +1,164 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// Transform cost per event, for a stage doing channel remap, transpose, velocity curve
+// and a two-type filter.
+//
+// Reported, best of a few runs: the stage alone over random channel messages, next to a
+// loop that only copies them, and processEvents per event for an instance with and
+// without the stage.
+//
+// usage: BenchTransform
+
+#include "JackAssTest.hpp"
+
+static const char* const    kSpec        = "channel=*:10;transpose=-12;velocity=0.5;filter=pitchbend,program";
+static const jack_nframes_t kBufferSize  = 256;
+static const uint32_t       kMessages    = 4096;
+static const int            kPasses      = 10000;
+static const int            kCycles      = 10000;
+static const int            kCycleEvents = 64;
+
+static void runStage()
+{
+    JackAssTransform transform;
+
+    if (! transform.parse(kSpec))
+    {
+        std::printf("invalid spec\n");
+        return;
+    }
+
+    std::vector<unsigned char> messages(kMessages*4);
+    std::srand(1);
+
+    for (uint32_t i=0; i < kMessages; ++i)
+    {
+        messages[i*4]   = (unsigned char)(0x80 + (std::rand() % 0x70));
+        messages[i*4+1] = (unsigned char)(std::rand() & 0x7f);
+        messages[i*4+2] = (unsigned char)(std::rand() & 0x7f);
+        messages[i*4+3] = 0;
+    }
+
+    // copy only, to compare with the stage loop
+    uint32_t check = 0;
+    double copyTime = 0.0, stageTime = 0.0;
+
+    for (int round=0; round < 5; ++round)
+    {
+        double start(benchTime());
+
+        for (int k=0; k < kPasses; ++k)
+        {
+            for (uint32_t i=0; i < kMessages; ++i)
+            {
+                unsigned char data[4];
+                std::memcpy(data, &messages[i*4], 4);
+                check += data[0] + data[1];
+            }
+
+            __asm__ __volatile__("" ::: "memory");
+        }
+
+        const double copy(benchTime() - start);
+
+        start = benchTime();
+
+        for (int k=0; k < kPasses; ++k)
+        {
+            for (uint32_t i=0; i < kMessages; ++i)
+            {
+                unsigned char data[4];
+                std::memcpy(data, &messages[i*4], 4);
+
+                if (transform.process(data))
+                    check += data[0] + data[1];
+            }
+
+            __asm__ __volatile__("" ::: "memory");
+        }
+
+        const double stage(benchTime() - start);
+
+        if (round == 0 || copy < copyTime)
+            copyTime = copy;
+        if (round == 0 || stage < stageTime)
+            stageTime = stage;
+    }
+
+    const double count(double(kMessages) * kPasses);
+
+    std::printf("stage:   %.0fM events, %5.2f ns per event, copy loop alone %5.2f, check %u\n",
+                count / 1e6, stageTime / count * 1e9, copyTime / count * 1e9, check);
+}
+
+static double runPlugin(const bool withTransform)
+{
+    if (withTransform)
+        setenv("JACKASS_TRANSFORM", kSpec, 1);
+
+    JackAss* const plugin(new JackAss(testAudioMaster));
+
+    unsetenv("JACKASS_TRANSFORM");
+
+    TestMidiSink sink("sink");
+    sink.connect("JackAss:midi-out_01");
+
+    jackbridge_fake_run_cycles(2);
+
+    double hostTime = 0.0;
+
+    for (int k=0; k < kCycles; ++k)
+    {
+        const double start(benchTime());
+
+        for (int j=0; j < kCycleEvents; ++j)
+            testSendMidi(plugin, (unsigned char)(0x90 + (j & 0x0f)), (unsigned char)(36 + j), 100, VstInt32(j * (kBufferSize / kCycleEvents)));
+
+        hostTime += benchTime() - start;
+
+        sink.events.clear();
+        jackbridge_fake_run_cycles(1);
+    }
+
+    delete plugin;
+
+    return hostTime / (double(kCycles) * kCycleEvents) * 1e9;
+}
+
+int main()
+{
+    jackbridge_fake_set_engine(48000, kBufferSize, false);
+
+    runStage();
+
+    double without = 0.0, with = 0.0;
+
+    for (int i=0; i < 5; ++i)
+    {
+        const double a(runPlugin(false));
+        const double b(runPlugin(true));
+
+        if (i == 0 || a < without)
+            without = a;
+        if (i == 0 || b < with)
+            with = b;
+    }
+
+    std::printf("plugin:  %5.1f ns per event without transform, %5.1f with\n", without, with);
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// Time of one process cycle against the instance count, with the work split over 1, 2
+// and 4 threads. kMinPartInstances is the count where 2 parts start to beat 1.
+//
+// usage: BenchWorkers [parameter changes per instance and cycle, default 4]
+
+#include "JackAssTest.hpp"
+
+int main(int argc, char* argv[])
+{
+    static const int kCycles = 4000;
+    static const int kInstanceCounts[] = { 4, 8, 16, 24, 32, 48, 64, 96, 128 };
+
+    const int changes((argc > 1) ? std::atoi(argv[1]) : 4);
+
+    setenv("JACKASS_PROCESS_THREADS", "3", 1);
+    jackbridge_fake_set_engine(48000, 256, false);
+
+    std::vector<JackAss*> plugins;
+    TestMidiSink sink("sink");
+
+    for (size_t c=0; c < sizeof(kInstanceCounts)/sizeof(int); ++c)
+    {
+        while (int(plugins.size()) < kInstanceCounts[c])
+        {
+            char portName[32];
+            plugins.push_back(new JackAss(testAudioMaster));
+            std::snprintf(portName, 32, "JackAss:midi-out_%02i", int(plugins.size()));
+            sink.connect(portName);
+        }
+
+        std::printf("%3i instances:", kInstanceCounts[c]);
+
+        for (int parts=1; parts <= 4; parts *= 2)
+        {
+            double total = 0.0;
+
+            for (int k=0; k < kCycles; ++k)
+            {
+                for (size_t i=0; i < plugins.size(); ++i)
+                {
+                    for (int j=0; j < changes; ++j)
+                        plugins[i]->setParameter(j % gParamCount, float((k+j) & 127) / 127.0f);
+                }
+
+                jack_nframes_t nframes(256);
+                const double start(benchTime());
+
+                // same as jprocess_callback, with the part count forced
+                pthread_mutex_lock(&gInstancesMutex);
+                gWorkerPool.run(parts, jprocess_part, &nframes);
+                pthread_mutex_unlock(&gInstancesMutex);
+
+                total += benchTime() - start;
+            }
+
+            std::printf("  %i part%s %7.2f us", parts, (parts > 1) ? "s" : " ", total / kCycles * 1e6);
+        }
+
+        std::printf("\n");
+    }
+
+    for (size_t i=0; i < plugins.size(); ++i)
+        delete plugins[i];
+
+    return 0;
+}
@@ -0,0 +1,165 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef JACKASS_TEST_HPP_INCLUDED
+#define JACKASS_TEST_HPP_INCLUDED
+
+// Tests build the whole plugin in, against the fake JACK engine (JACKBRIDGE_FAKE).
+// Cycles only run when a test asks for them, so results do not depend on timing.
+#include "../JackAss.cpp"
+
+#include <cstdio>
+#include <ctime>
+#include <vector>
+
+// -------------------------------------------------
+// checks
+
+static int gTestFailures = 0;
+
+#define JACKASS_CHECK(cond)                                                          \
+    do {                                                                             \
+        if (! (cond))                                                                \
+        {                                                                            \
+            std::fprintf(stderr, "%s:%i: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++gTestFailures;                                                         \
+        }                                                                            \
+    } while (false)
+
+static inline
+int testResult(const char* const name)
+{
+    if (gTestFailures == 0)
+        std::printf("%s: ok\n", name);
+    else
+        std::printf("%s: %i failed\n", name, gTestFailures);
+
+    return (gTestFailures == 0) ? 0 : 1;
+}
+
+// monotonic time in seconds, for benchmarks
+static inline
+double benchTime()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return double(ts.tv_sec) + double(ts.tv_nsec) * 1e-9;
+}
+
+// -------------------------------------------------
+// plugin helpers
+
+static inline
+VstIntPtr testAudioMaster(AEffect*, VstInt32, VstInt32, VstIntPtr, void*, float)
+{
+    return 0;
+}
+
+static inline
+void testSendMidi(JackAss* const plugin, const unsigned char status, const unsigned char data1,
+                  const unsigned char data2, const VstInt32 deltaFrames)
+{
+    VstMidiEvent midiEvent;
+    std::memset(&midiEvent, 0, sizeof(VstMidiEvent));
+    midiEvent.type          = kVstMidiType;
+    midiEvent.byteSize      = sizeof(VstMidiEvent);
+    midiEvent.deltaFrames   = deltaFrames;
+    midiEvent.midiData[0]   = (char)status;
+    midiEvent.midiData[1]   = (char)data1;
+    midiEvent.midiData[2]   = (char)data2;
+
+    VstEvents events;
+    std::memset(&events, 0, sizeof(VstEvents));
+    events.numEvents = 1;
+    events.events[0] = (VstEvent*)&midiEvent;
+
+    plugin->processEvents(&events);
+}
+
+// -------------------------------------------------
+// a JACK client with one MIDI input, keeps everything it receives
+
+struct TestMidiEvent {
+    uint64_t      frame; // since the sink was activated
+    uint32_t      size;
+    unsigned char data[4];
+};
+
+class TestMidiSink
+{
+public:
+    TestMidiSink(const char* const name)
+        : fFrame(0)
+    {
+        fClient = jackbridge_client_open(name, JackNullOption, nullptr);
+        fPort   = jackbridge_port_register(fClient, "in", JACK_DEFAULT_MIDI_TYPE, JackPortIsInput, 0);
+
+        jackbridge_set_process_callback(fClient, _process, this);
+        jackbridge_activate(fClient);
+    }
+
+    ~TestMidiSink()
+    {
+        jackbridge_client_close(fClient);
+    }
+
+    bool connect(const char* const source)
+    {
+        return jackbridge_connect(fClient, source, jackbridge_port_name(fPort));
+    }
+
+    bool disconnect(const char* const source)
+    {
+        return jackbridge_disconnect(fClient, source, jackbridge_port_name(fPort));
+    }
+
+    std::vector<TestMidiEvent> events;
+
+private:
+    jack_client_t* fClient;
+    jack_port_t*   fPort;
+    uint64_t       fFrame;
+
+    static int _process(const jack_nframes_t nframes, void* const ptr)
+    {
+        TestMidiSink* const self((TestMidiSink*)ptr);
+
+        if (void* const buffer = jackbridge_port_get_buffer(self->fPort, nframes))
+        {
+            jack_midi_event_t jevent;
+
+            for (uint32_t i=0, count=jackbridge_midi_get_event_count(buffer); i < count; ++i)
+            {
+                if (! jackbridge_midi_event_get(&jevent, buffer, i) || jevent.size > 4)
+                    continue;
+
+                TestMidiEvent event;
+                event.frame = self->fFrame + jevent.time;
+                event.size  = uint32_t(jevent.size);
+                std::memset(event.data, 0, 4);
+                std::memcpy(event.data, jevent.buffer, jevent.size);
+                self->events.push_back(event);
+            }
+        }
+
+        self->fFrame += nframes;
+        return 0;
+    }
+};
+
+// -------------------------------------------------
+
+#endif // JACKASS_TEST_HPP_INCLUDED
@@ -0,0 +1,73 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// Audio ring: a JACK period larger than the one the ring was set up for still carries
+// audio, and a new period only moves the target latency.
+
+#include "JackAssTest.hpp"
+
+#include <cmath>
+
+static const uint32_t kHostBlock = 256;
+static const uint32_t kLargeBlock = 4096;
+
+static float gLeft[kLargeBlock];
+static float gRight[kLargeBlock];
+
+static void fill(const float value, const uint32_t frames)
+{
+    for (uint32_t i=0; i < frames; ++i)
+    {
+        gLeft[i]  = value;
+        gRight[i] = -value;
+    }
+}
+
+int main()
+{
+    JackAssAudioRing ring;
+    ring.init(kHostBlock*2, kHostBlock);
+    JACKASS_CHECK(ring.getLatency() == kHostBlock*2);
+
+    // the JACK period grew to 4096 frames after init, reads of that size are not silent
+    fill(0.5f, kLargeBlock);
+    ring.write(gLeft, gRight, kLargeBlock);
+    ring.write(gLeft, gRight, kLargeBlock);
+    JACKASS_CHECK(ring.getOverruns() == 0);
+
+    fill(0.0f, kLargeBlock);
+    ring.read(gLeft, gRight, kLargeBlock, 1.0f);
+    JACKASS_CHECK(ring.getUnderruns() == 0);
+
+    // the initial latency is silence, the rest is what was written
+    JACKASS_CHECK(gLeft[0] == 0.0f && gRight[0] == 0.0f);
+    JACKASS_CHECK(std::fabs(gLeft[kLargeBlock-1] - 0.5f) < 1e-6f);
+    JACKASS_CHECK(std::fabs(gRight[kLargeBlock-1] + 0.5f) < 1e-6f);
+
+    // the gain is applied across chunks
+    ring.read(gLeft, gRight, kLargeBlock/2, 2.0f);
+    JACKASS_CHECK(std::fabs(gLeft[0] - 1.0f) < 1e-6f);
+    JACKASS_CHECK(std::fabs(gLeft[kLargeBlock/2-1] - 1.0f) < 1e-6f);
+
+    // new target, clamped to what the ring can hold
+    ring.setTarget(kHostBlock + kLargeBlock);
+    JACKASS_CHECK(ring.getLatency() == kHostBlock + kLargeBlock);
+
+    ring.setTarget(0xFFFFFF);
+    JACKASS_CHECK(ring.getLatency() < 0xFFFFFF);
+
+    return testResult("TestAudio");
+}
@@ -0,0 +1,134 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// Capture file: the helper thread opens and closes it on request, events written before
+// the file is ready are kept, and a second capture goes to its own file.
+
+#include "JackAssTest.hpp"
+
+#include <sys/stat.h>
+
+#ifndef JACKASS_CAPTURE_UNSUPPORTED
+static const uint32_t kEventCount = 2000;
+
+static void writeEvents(JackAssCapture& capture, const uint64_t offset)
+{
+    for (uint32_t i=0; i < kEventCount; ++i)
+    {
+        const unsigned char data[4] = { 0xB0, (unsigned char)(i & 0x7f), 0, 0 };
+        JACKASS_CHECK(capture.write(offset + i, data, 3));
+
+        if (i % 100 == 99)
+            usleep(1000);
+    }
+}
+
+// the helper closes the file after requestClose(), the tail is cut down to the last event
+static bool waitForSize(const char* const filename, const off_t size)
+{
+    struct stat st;
+
+    for (int i=0; i < 2000; ++i)
+    {
+        if (::stat(filename, &st) == 0 && st.st_size == size)
+            return true;
+
+        usleep(1000);
+    }
+
+    return false;
+}
+
+static void checkFile(const char* const filename, const uint64_t offset)
+{
+    FILE* const file(std::fopen(filename, "rb"));
+    JACKASS_CHECK(file != nullptr);
+
+    if (file == nullptr)
+        return;
+
+    unsigned char header[kCaptureHeaderSize];
+    uint32_t version = 0, sampleRate = 0;
+
+    JACKASS_CHECK(std::fread(header, 1, kCaptureHeaderSize, file) == kCaptureHeaderSize);
+    std::memcpy(&version, header+8, sizeof(uint32_t));
+    std::memcpy(&sampleRate, header+12, sizeof(uint32_t));
+
+    JACKASS_CHECK(std::memcmp(header, kCaptureMagic, sizeof(kCaptureMagic)) == 0);
+    JACKASS_CHECK(version == kCaptureVersion);
+    JACKASS_CHECK(sampleRate == 48000);
+
+    capture_event_t event;
+    uint32_t count = 0;
+
+    while (std::fread(&event, sizeof(capture_event_t), 1, file) == 1)
+    {
+        JACKASS_CHECK(event.frame == offset + count && event.size == 3 && event.data[1] == (count & 0x7f));
+        ++count;
+    }
+
+    JACKASS_CHECK(count == kEventCount);
+    std::fclose(file);
+}
+#endif
+
+int main()
+{
+#ifndef JACKASS_CAPTURE_UNSUPPORTED
+    char dir[] = "/tmp/jackass-capture-XXXXXX";
+    JACKASS_CHECK(::mkdtemp(dir) != nullptr);
+
+    char first[64], second[64];
+    std::snprintf(first, 64, "%s/first.jackass", dir);
+    std::snprintf(second, 64, "%s/second.jackass", dir);
+
+    const off_t fileSize(off_t(kCaptureHeaderSize + kEventCount * sizeof(capture_event_t)));
+
+    JackAssCapture capture;
+
+    // nothing to write to before start()
+    JACKASS_CHECK(! capture.requestOpen(first, 48000));
+    JACKASS_CHECK(capture.start());
+
+    JACKASS_CHECK(capture.requestOpen(first, 48000));
+    writeEvents(capture, 0);
+    capture.requestClose();
+
+    JACKASS_CHECK(waitForSize(first, fileSize));
+
+    // not capturing, events are refused
+    const unsigned char data[4] = { 0x90, 60, 100, 0 };
+    JACKASS_CHECK(! capture.write(0, data, 3));
+
+    JACKASS_CHECK(capture.requestOpen(second, 48000));
+    writeEvents(capture, 1000000);
+
+    // stop() closes whatever is still open
+    capture.stop();
+
+    struct stat st;
+    JACKASS_CHECK(::stat(second, &st) == 0 && st.st_size == fileSize);
+
+    checkFile(first, 0);
+    checkFile(second, 1000000);
+
+    ::unlink(first);
+    ::unlink(second);
+    ::rmdir(dir);
+#endif
+
+    return testResult("TestCapture");
+}
@@ -0,0 +1,117 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// CV outputs, run with JACKASS_CV_PORTS="1=linear,2=smooth". A linear ramp ends exactly
+// on its target, a smooth one continues across cycles and settles on it.
+// The period is odd so the SSE loops leave a remainder.
+
+#include "JackAssTest.hpp"
+
+static const jack_nframes_t kBufferSize = 99;
+
+static const float* getBuffer(const char* const portName)
+{
+    jack_client_t* const client(jackbridge_client_open("reader", JackNullOption, nullptr));
+    jack_port_t* const port(jackbridge_port_by_name(client, portName));
+    const float* const buffer((port != nullptr) ? (const float*)jackbridge_port_get_buffer(port, kBufferSize) : nullptr);
+    jackbridge_client_close(client);
+
+    return buffer;
+}
+
+static void testLinear(JackAss* const plugin, const float* const buffer)
+{
+    const float start(buffer[kBufferSize-1]);
+    const float target(float(getParameterValue14(0.7f)) / 16383.0f);
+
+    plugin->setParameter(0, 0.7f);
+    jackbridge_fake_run_cycles(1);
+
+    // straight and rising, landing on the target
+    JACKASS_CHECK(buffer[kBufferSize-1] == target);
+    JACKASS_CHECK(buffer[0] > start);
+
+    const float step((target - start) / float(kBufferSize));
+
+    for (jack_nframes_t i=1; i < kBufferSize; ++i)
+    {
+        JACKASS_CHECK(buffer[i] > buffer[i-1]);
+        JACKASS_CHECK(std::fabs((buffer[i] - buffer[i-1]) - step) < 1e-5f);
+    }
+
+    // and flat after that
+    jackbridge_fake_run_cycles(1);
+
+    for (jack_nframes_t i=0; i < kBufferSize; ++i)
+        JACKASS_CHECK(buffer[i] == target);
+
+    // down again, a second change within the same cycle only counts once
+    const float target2(float(getParameterValue14(0.2f)) / 16383.0f);
+
+    plugin->setParameter(0, 0.9f);
+    plugin->setParameter(0, 0.2f);
+    jackbridge_fake_run_cycles(1);
+
+    JACKASS_CHECK(buffer[kBufferSize-1] == target2);
+    JACKASS_CHECK(buffer[0] < target && buffer[0] > target2);
+}
+
+static void testSmooth(JackAss* const plugin, const float* const buffer)
+{
+    const float target(float(getParameterValue14(1.0f)) / 16383.0f);
+
+    plugin->setParameter(1, 1.0f);
+    jackbridge_fake_run_cycles(1);
+
+    float last(buffer[kBufferSize-1]);
+    JACKASS_CHECK(last < target);
+
+    for (jack_nframes_t i=1; i < kBufferSize; ++i)
+        JACKASS_CHECK(buffer[i] >= buffer[i-1]);
+
+    // picks up where the previous cycle stopped
+    jackbridge_fake_run_cycles(1);
+    JACKASS_CHECK(buffer[0] >= last && buffer[0] - last < 0.01f);
+
+    // settled after enough time constants
+    jackbridge_fake_run_cycles(uint32_t(kCvSmoothTime * 48000 * 20 / kBufferSize));
+    JACKASS_CHECK(buffer[kBufferSize-1] == target);
+}
+
+int main()
+{
+    jackbridge_fake_set_engine(48000, kBufferSize, false);
+
+    JACKASS_CHECK(gCvModeMap.mode[0] == kCvLinear && gCvModeMap.mode[1] == kCvSmooth);
+
+    JackAss* const plugin(new JackAss(testAudioMaster));
+    jackbridge_fake_run_cycles(1);
+
+    const float* const linear(getBuffer("JackAss:cv-out_01-cc001"));
+    const float* const smooth(getBuffer("JackAss:cv-out_01-cc002"));
+
+    JACKASS_CHECK(linear != nullptr && smooth != nullptr);
+
+    if (linear != nullptr && smooth != nullptr)
+    {
+        testLinear(plugin, linear);
+        testSmooth(plugin, smooth);
+    }
+
+    delete plugin;
+
+    return testResult("TestCv");
+}
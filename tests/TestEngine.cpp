@@ -0,0 +1,132 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// Events from the host reach a connected JACK port through jprocess, at their block offset.
+
+#include "JackAssTest.hpp"
+
+static const jack_nframes_t kBufferSize = 256;
+
+static void testNoteTiming()
+{
+    JackAss* const plugin(new JackAss(testAudioMaster));
+    TestMidiSink sink("sink");
+
+    JACKASS_CHECK(sink.connect("JackAss:midi-out_01"));
+
+    // the connection state refresh goes out first
+    jackbridge_fake_run_cycles(2);
+    sink.events.clear();
+
+    testSendMidi(plugin, 0x90, 60, 100, 10);
+    testSendMidi(plugin, 0x80, 60, 0, 200);
+    jackbridge_fake_run_cycles(1);
+
+    JACKASS_CHECK(sink.events.size() == 2);
+
+    if (sink.events.size() == 2)
+    {
+        JACKASS_CHECK(sink.events[0].data[0] == 0x90 && sink.events[0].data[1] == 60 && sink.events[0].data[2] == 100);
+        JACKASS_CHECK(sink.events[0].frame == 2*kBufferSize + 10);
+        JACKASS_CHECK(sink.events[1].data[0] == 0x80 && sink.events[1].data[1] == 60);
+        JACKASS_CHECK(sink.events[1].frame == 2*kBufferSize + 200);
+    }
+
+    // nothing is queued while nobody listens
+    sink.events.clear();
+    JACKASS_CHECK(sink.disconnect("JackAss:midi-out_01"));
+    jackbridge_fake_run_cycles(1);
+
+    testSendMidi(plugin, 0x90, 61, 100, 0);
+    jackbridge_fake_run_cycles(1);
+    JACKASS_CHECK(sink.connect("JackAss:midi-out_01"));
+    jackbridge_fake_run_cycles(2);
+
+    for (size_t i=0; i < sink.events.size(); ++i)
+        JACKASS_CHECK(sink.events[i].data[0] != 0x90);
+
+    delete plugin;
+}
+
+static void testIdleClear()
+{
+    JackAss* const plugin(new JackAss(testAudioMaster));
+    TestMidiSink sink("sink");
+
+    jack_client_t* const client(jackbridge_client_open("other", JackNullOption, nullptr));
+    jack_port_t* const port(jackbridge_port_by_name(client, "JackAss:midi-out_01"));
+
+    JACKASS_CHECK(sink.connect("JackAss:midi-out_01"));
+    jackbridge_fake_run_cycles(2);
+
+    testSendMidi(plugin, 0x90, 60, 100, 0);
+    jackbridge_fake_run_cycles(1);
+    JACKASS_CHECK(jackbridge_midi_get_event_count(jackbridge_port_get_buffer(port, kBufferSize)) == 1);
+
+    // JACK keeps the buffer, the next reader must not find the note in it
+    JACKASS_CHECK(sink.disconnect("JackAss:midi-out_01"));
+    jackbridge_fake_run_cycles(1);
+    JACKASS_CHECK(jackbridge_midi_get_event_count(jackbridge_port_get_buffer(port, kBufferSize)) == 0);
+
+    jackbridge_client_close(client);
+    delete plugin;
+}
+
+static void testPortRename()
+{
+    JackAss* const plugin(new JackAss(testAudioMaster));
+    TestMidiSink sink("sink");
+
+    jack_client_t* const client(jackbridge_client_open("other", JackNullOption, nullptr));
+    jack_port_t* const port1(jackbridge_port_register(client, "one", JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0));
+    jack_port_t* const port2(jackbridge_port_register(client, "two", JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0));
+
+    JACKASS_CHECK(jackbridge_port_set_name(port1, "renamed"));
+    JACKASS_CHECK(std::strcmp(jackbridge_port_name(port1), "other:renamed") == 0);
+    JACKASS_CHECK(std::strcmp(jackbridge_port_short_name(port1), "renamed") == 0);
+    JACKASS_CHECK(jackbridge_port_by_name(client, "other:renamed") == port1);
+    JACKASS_CHECK(jackbridge_port_by_name(client, "other:one") == nullptr);
+
+    // names stay unique
+    JACKASS_CHECK(! jackbridge_port_set_name(port2, "renamed"));
+    JACKASS_CHECK(std::strcmp(jackbridge_port_name(port2), "other:two") == 0);
+
+    // connections follow the port
+    JACKASS_CHECK(sink.connect("JackAss:midi-out_01"));
+    jackbridge_fake_run_cycles(2);
+    sink.events.clear();
+
+    JACKASS_CHECK(jackbridge_port_set_name(jackbridge_port_by_name(client, "JackAss:midi-out_01"), "synth"));
+    testSendMidi(plugin, 0x90, 62, 100, 0);
+    jackbridge_fake_run_cycles(1);
+
+    JACKASS_CHECK(sink.events.size() == 1);
+    JACKASS_CHECK(jackbridge_port_by_name(client, "JackAss:synth") != nullptr);
+
+    jackbridge_client_close(client);
+    delete plugin;
+}
+
+int main()
+{
+    jackbridge_fake_set_engine(48000, kBufferSize, false);
+
+    testNoteTiming();
+    testIdleClear();
+    testPortRename();
+
+    return testResult("TestEngine");
+}
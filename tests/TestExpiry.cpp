@@ -0,0 +1,92 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// Event expiry, default times: events that waited past their class time are dropped,
+// except note-offs, and an expired CC is replaced by a resend of the current value.
+// A stalled JACK thread is simulated by moving the fake engine clock without cycles.
+
+#include "JackAssTest.hpp"
+
+static const jack_nframes_t kSampleRate = 48000;
+static const jack_nframes_t kBufferSize = 256;
+
+static void stall(const uint32_t ms)
+{
+    gFakeEngine.frameTime += uint64_t(kSampleRate) * ms / 1000;
+}
+
+static bool hasEvent(const std::vector<TestMidiEvent>& events, const unsigned char status, const unsigned char data1)
+{
+    for (size_t i=0; i < events.size(); ++i)
+    {
+        if (events[i].data[0] == status && events[i].data[1] == data1)
+            return true;
+    }
+
+    return false;
+}
+
+int main()
+{
+    jackbridge_fake_set_engine(kSampleRate, kBufferSize, false);
+
+    JackAss* const plugin(new JackAss(testAudioMaster));
+    TestMidiSink sink("sink");
+
+    JACKASS_CHECK(sink.connect("JackAss:midi-out_01"));
+    jackbridge_fake_run_cycles(2);
+    sink.events.clear();
+
+    // a short wait is fine
+    testSendMidi(plugin, 0x90, 60, 100, 0);
+    stall(kExpiryNoteTime/2);
+    jackbridge_fake_run_cycles(1);
+
+    JACKASS_CHECK(hasEvent(sink.events, 0x90, 60));
+
+    // a late note-on is dropped, its note-off still goes out
+    sink.events.clear();
+    testSendMidi(plugin, 0x90, 61, 100, 0);
+    testSendMidi(plugin, 0x80, 60, 0, 0);
+    stall(kExpiryNoteTime*2);
+    jackbridge_fake_run_cycles(1);
+
+    JACKASS_CHECK(! hasEvent(sink.events, 0x90, 61));
+    JACKASS_CHECK(hasEvent(sink.events, 0x80, 60));
+
+    // clocks expire sooner than notes
+    sink.events.clear();
+    testSendMidi(plugin, 0xF8, 0, 0, 0);
+    testSendMidi(plugin, 0x90, 62, 100, 0);
+    stall(kExpiryRealtimeTime*2);
+    jackbridge_fake_run_cycles(1);
+
+    JACKASS_CHECK(! hasEvent(sink.events, 0xF8, 0));
+    JACKASS_CHECK(hasEvent(sink.events, 0x90, 62));
+
+    // a late CC still leaves the receiver with the current value
+    sink.events.clear();
+    plugin->setParameter(0, 64.0f/127.0f + 0.001f);
+    stall(kExpiryOtherTime*2);
+    jackbridge_fake_run_cycles(2);
+
+    JACKASS_CHECK(sink.events.size() == 1);
+    JACKASS_CHECK(sink.events.size() == 1 && sink.events[0].data[0] == 0xB0 && sink.events[0].data[1] == 1 && sink.events[0].data[2] == 64);
+
+    delete plugin;
+
+    return testResult("TestExpiry");
+}
@@ -0,0 +1,125 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// Hub side of a slot: ring events come out in time order, controllers are resent per
+// channel, and whatever a client process left in shared memory cannot make the hub read
+// or write out of bounds.
+
+#include "JackAssTest.hpp"
+
+static const jack_nframes_t kBufferSize = 256;
+
+static hub_slot_t gSlot;
+static hub_port_t gPort;
+
+static int hubProcess(const jack_nframes_t nframes, void*)
+{
+    int resendBudget = 64;
+    hub_process_slot(gPort, gSlot, nframes, resendBudget);
+    return 0;
+}
+
+static void putEvent(const uint32_t time, const unsigned char size, const unsigned char status)
+{
+    hub_event_t& event(gSlot.events[gSlot.head & (kHubRingSize-1)]);
+    event.time    = time;
+    event.size    = size;
+    event.data[0] = status;
+    event.data[1] = 60;
+    event.data[2] = 100;
+    ++gSlot.head;
+}
+
+int main()
+{
+    jackbridge_fake_set_engine(48000, kBufferSize, false);
+
+    jack_client_t* const client(jackbridge_client_open("JackAss-Hub", JackNullOption, nullptr));
+    std::memset(&gSlot, 0, sizeof(gSlot));
+    std::memset(&gPort, 0, sizeof(gPort));
+    gPort.port = jackbridge_port_register(client, "slot", JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0);
+    jackbridge_set_process_callback(client, hubProcess, nullptr);
+    jackbridge_activate(client);
+
+    TestMidiSink sink("sink");
+    JACKASS_CHECK(sink.connect("JackAss-Hub:slot"));
+    gSlot.connected = 1;
+
+    // sorted by time, late times clamped to the last frame
+    putEvent(200, 3, 0x90);
+    putEvent(10, 3, 0x91);
+    putEvent(5000, 3, 0x92);
+    jackbridge_fake_run_cycles(1);
+
+    JACKASS_CHECK(sink.events.size() == 3);
+    JACKASS_CHECK(gSlot.tail == gSlot.head);
+
+    if (sink.events.size() == 3)
+    {
+        JACKASS_CHECK(sink.events[0].data[0] == 0x91 && sink.events[0].frame == 10);
+        JACKASS_CHECK(sink.events[1].data[0] == 0x90 && sink.events[1].frame == 200);
+        JACKASS_CHECK(sink.events[2].data[0] == 0x92 && sink.events[2].frame == kBufferSize-1);
+    }
+
+    // bad sizes are skipped, the rest still goes out
+    sink.events.clear();
+    putEvent(0, 0, 0x90);
+    putEvent(1, 200, 0x90);
+    putEvent(2, 3, 0x93);
+    jackbridge_fake_run_cycles(1);
+
+    JACKASS_CHECK(sink.events.size() == 1);
+    JACKASS_CHECK(sink.events.size() == 1 && sink.events[0].data[0] == 0x93);
+
+    // a ring claiming more than it can hold is dropped as a whole
+    sink.events.clear();
+    gSlot.head = gSlot.tail + kHubRingSize*4;
+    jackbridge_fake_run_cycles(1);
+
+    JACKASS_CHECK(sink.events.empty());
+    JACKASS_CHECK(gSlot.tail == gSlot.head);
+
+    // and a full one is fine
+    for (uint32_t i=0; i < kHubRingSize; ++i)
+        putEvent(i % kBufferSize, 3, 0xB0);
+    jackbridge_fake_run_cycles(1);
+
+    JACKASS_CHECK(gSlot.tail == gSlot.head);
+
+    // controllers are resent on their own channel, the same CC on two channels is two values
+    sink.events.clear();
+    gSlot.ccValues[0][7] = 100;
+    gSlot.ccSet[0][7]    = 1;
+    gSlot.ccValues[3][7] = 64;
+    gSlot.ccSet[3][7]    = 1;
+    gPort.resendPending  = true;
+    gPort.resendPos      = 0;
+    jackbridge_fake_run_cycles(1);
+
+    JACKASS_CHECK(sink.events.size() == 2);
+
+    if (sink.events.size() == 2)
+    {
+        JACKASS_CHECK(sink.events[0].data[0] == 0xB0 && sink.events[0].data[1] == 7 && sink.events[0].data[2] == 100);
+        JACKASS_CHECK(sink.events[1].data[0] == 0xB3 && sink.events[1].data[1] == 7 && sink.events[1].data[2] == 64);
+    }
+
+    JACKASS_CHECK(! gPort.resendPending);
+
+    jackbridge_client_close(client);
+
+    return testResult("TestHub");
+}
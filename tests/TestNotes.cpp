@@ -0,0 +1,136 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// Active note bitmap: suspend sends a note-off for exactly the notes still held, spread
+// over cycles when there are many, and never for a note played again in the meantime.
+
+#include "JackAssTest.hpp"
+
+static const jack_nframes_t kBufferSize = 256;
+
+static int countNoteOffs(const std::vector<TestMidiEvent>& events)
+{
+    int count = 0;
+
+    for (size_t i=0; i < events.size(); ++i)
+    {
+        if ((events[i].data[0] & 0xF0) == 0x80)
+            ++count;
+    }
+
+    return count;
+}
+
+static void testHeldNotes(JackAss* const plugin, TestMidiSink& sink)
+{
+    testSendMidi(plugin, 0x90, 60, 100, 0);
+    testSendMidi(plugin, 0x92, 64, 100, 0);
+    testSendMidi(plugin, 0x90, 61, 100, 0);
+    testSendMidi(plugin, 0x80, 61, 0, 10);
+    testSendMidi(plugin, 0x90, 62, 100, 0);
+    testSendMidi(plugin, 0x90, 62, 0, 20); // note-on at velocity 0 is a note-off
+    jackbridge_fake_run_cycles(1);
+    sink.events.clear();
+
+    plugin->suspend();
+    jackbridge_fake_run_cycles(1);
+
+    JACKASS_CHECK(sink.events.size() == 2);
+
+    if (sink.events.size() == 2)
+    {
+        JACKASS_CHECK(sink.events[0].data[0] == 0x80 && sink.events[0].data[1] == 60 && sink.events[0].data[2] == 0);
+        JACKASS_CHECK(sink.events[1].data[0] == 0x82 && sink.events[1].data[1] == 64 && sink.events[1].data[2] == 0);
+        JACKASS_CHECK(sink.events[0].frame % kBufferSize == kBufferSize-1);
+    }
+
+    // nothing left for a second suspend
+    sink.events.clear();
+    plugin->suspend();
+    jackbridge_fake_run_cycles(1);
+    JACKASS_CHECK(sink.events.empty());
+}
+
+static void testManyNotes(JackAss* const plugin, TestMidiSink& sink)
+{
+    for (int channel=0; channel < 2; ++channel)
+    {
+        for (int note=0; note < 128; ++note)
+            testSendMidi(plugin, (unsigned char)(0x90 | channel), (unsigned char)note, 100, 0);
+
+        jackbridge_fake_run_cycles(1);
+    }
+
+    sink.events.clear();
+    plugin->suspend();
+
+    // a limited number per cycle, all of them in the end
+    jackbridge_fake_run_cycles(1);
+    JACKASS_CHECK(countNoteOffs(sink.events) == kMaxNoteOffEvents);
+
+    jackbridge_fake_run_cycles(256/kMaxNoteOffEvents);
+    JACKASS_CHECK(countNoteOffs(sink.events) == 256);
+
+    jackbridge_fake_run_cycles(1);
+    JACKASS_CHECK(countNoteOffs(sink.events) == 256);
+}
+
+static void testPlayedAgain(JackAss* const plugin, TestMidiSink& sink)
+{
+    testSendMidi(plugin, 0x90, 60, 100, 0);
+    testSendMidi(plugin, 0x90, 67, 100, 0);
+    jackbridge_fake_run_cycles(1);
+    sink.events.clear();
+
+    // 67 comes back before the JACK thread sent the note-offs
+    plugin->suspend();
+    testSendMidi(plugin, 0x90, 67, 90, 0);
+    jackbridge_fake_run_cycles(1);
+
+    JACKASS_CHECK(countNoteOffs(sink.events) == 1);
+
+    for (size_t i=0; i < sink.events.size(); ++i)
+    {
+        if ((sink.events[i].data[0] & 0xF0) == 0x80)
+            JACKASS_CHECK(sink.events[i].data[1] == 60);
+    }
+
+    // and is still held
+    sink.events.clear();
+    plugin->suspend();
+    jackbridge_fake_run_cycles(1);
+
+    JACKASS_CHECK(sink.events.size() == 1 && sink.events[0].data[0] == 0x80 && sink.events[0].data[1] == 67);
+}
+
+int main()
+{
+    jackbridge_fake_set_engine(48000, kBufferSize, false);
+
+    JackAss* const plugin(new JackAss(testAudioMaster));
+    TestMidiSink sink("sink");
+
+    JACKASS_CHECK(sink.connect("JackAss:midi-out_01"));
+    jackbridge_fake_run_cycles(2);
+
+    testHeldNotes(plugin, sink);
+    testManyNotes(plugin, sink);
+    testPlayedAgain(plugin, sink);
+
+    delete plugin;
+
+    return testResult("TestNotes");
+}
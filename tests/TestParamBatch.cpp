@@ -0,0 +1,99 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// Vendor parameter batch: a ramp of changes comes out at the frame offsets of the batch,
+// and entries that are not valid are not counted.
+
+#include "JackAssTest.hpp"
+
+#include <limits>
+
+static const jack_nframes_t kBufferSize = 256;
+static const int            kRampSteps  = 16;
+
+static VstIntPtr sendBatch(JackAss* const plugin, const jackass_param_change_t* const changes, const int32_t count)
+{
+    jackass_param_batch_t batch;
+    batch.count   = count;
+    batch.changes = changes;
+
+    return plugin->vendorSpecific(kJackAssVendorIndex, kJackAssVendorParamBatch, &batch, 0.0f);
+}
+
+int main()
+{
+    jackbridge_fake_set_engine(48000, kBufferSize, false);
+
+    JackAss* const plugin(new JackAss(testAudioMaster));
+    TestMidiSink sink("sink");
+
+    JACKASS_CHECK(plugin->canDo((char*)kJackAssCanDoParamBatch) == 1);
+
+    JACKASS_CHECK(sink.connect("JackAss:midi-out_01"));
+    jackbridge_fake_run_cycles(2);
+    sink.events.clear();
+
+    // CC 1 ramps up over the block, CC 2 ramps down in between
+    jackass_param_change_t changes[kRampSteps*2];
+
+    for (int i=0; i < kRampSteps; ++i)
+    {
+        changes[i*2].index   = 0;
+        changes[i*2].frame   = int32_t(i * kBufferSize / kRampSteps);
+        changes[i*2].value   = float(i*8 + 1) / 127.0f;
+        changes[i*2+1].index = 1;
+        changes[i*2+1].frame = changes[i*2].frame + 8;
+        changes[i*2+1].value = float(127 - i*8) / 127.0f;
+    }
+
+    JACKASS_CHECK(sendBatch(plugin, changes, kRampSteps*2) == kRampSteps*2);
+    jackbridge_fake_run_cycles(1);
+
+    JACKASS_CHECK(sink.events.size() == size_t(kRampSteps*2));
+
+    if (sink.events.size() == size_t(kRampSteps*2))
+    {
+        for (int i=0; i < kRampSteps*2; ++i)
+        {
+            const TestMidiEvent& event(sink.events[i]);
+
+            JACKASS_CHECK(event.frame == 2*kBufferSize + uint32_t(changes[i].frame));
+            JACKASS_CHECK(event.data[0] == 0xB0 && event.data[1] == changes[i].index + 1);
+            JACKASS_CHECK(event.data[2] == getParameterValue14(changes[i].value) >> 7);
+        }
+    }
+
+    JACKASS_CHECK(plugin->getParameter(0) == changes[kRampSteps*2-2].value);
+    JACKASS_CHECK(plugin->getParameter(1) == changes[kRampSteps*2-1].value);
+
+    // bad entries are skipped, the rest still applies
+    jackass_param_change_t bad[4];
+    bad[0].index = -1; bad[0].frame = 0;  bad[0].value = 0.5f;
+    bad[1].index = 0;  bad[1].frame = -4; bad[1].value = 0.5f;
+    bad[2].index = 0;  bad[2].frame = 0;  bad[2].value = std::numeric_limits<float>::quiet_NaN();
+    bad[3].index = 0;  bad[3].frame = 32; bad[3].value = 0.0f;
+
+    sink.events.clear();
+    JACKASS_CHECK(sendBatch(plugin, bad, 4) == 1);
+    jackbridge_fake_run_cycles(1);
+
+    JACKASS_CHECK(sink.events.size() == 1);
+    JACKASS_CHECK(sink.events.size() == 1 && sink.events[0].frame == 3*kBufferSize + 32 && sink.events[0].data[2] == 0);
+
+    delete plugin;
+
+    return testResult("TestParamBatch");
+}
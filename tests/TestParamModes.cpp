@@ -0,0 +1,112 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// High resolution parameter modes, run with JACKASS_PARAM_MODES="1=14bit,2=nrpn:0x205".
+// A change sends only the parts the receiver does not have, a new receiver gets everything.
+
+#include "JackAssTest.hpp"
+
+// parameter values that land exactly on a 14-bit step
+static float value14(const uint16_t value)
+{
+    return (float(value) + 0.25f) / 16383.0f;
+}
+
+static bool isMessage(const TestMidiEvent& event, const unsigned char status, const unsigned char cc, const unsigned char value)
+{
+    return event.size == 3 && event.data[0] == status && event.data[1] == cc && event.data[2] == value;
+}
+
+int main()
+{
+    jackbridge_fake_set_engine(48000, 256, false);
+
+    JACKASS_CHECK(gParamModeMap.mode[0] == kParamMode14Bit);
+    JACKASS_CHECK(gParamModeMap.mode[1] == kParamModeNRPN && gParamModeMap.number[1] == 0x205);
+
+    JackAss* const plugin(new JackAss(testAudioMaster));
+    TestMidiSink sink("sink");
+
+    JACKASS_CHECK(sink.connect("JackAss:midi-out_01"));
+    jackbridge_fake_run_cycles(2);
+    sink.events.clear();
+
+    // 14-bit, MSB on CC 1 and LSB on CC 33, then only the LSB when the MSB stays
+    plugin->setParameter(0, value14(0x1234));
+    jackbridge_fake_run_cycles(1);
+
+    JACKASS_CHECK(sink.events.size() == 2);
+
+    if (sink.events.size() == 2)
+    {
+        JACKASS_CHECK(isMessage(sink.events[0], 0xB0, 1, 0x24));
+        JACKASS_CHECK(isMessage(sink.events[1], 0xB0, 33, 0x34));
+    }
+
+    sink.events.clear();
+    plugin->setParameter(0, value14(0x1235));
+    jackbridge_fake_run_cycles(1);
+
+    JACKASS_CHECK(sink.events.size() == 1 && isMessage(sink.events[0], 0xB0, 33, 0x35));
+
+    // NRPN, selection and data entry, then only the data entry LSB
+    sink.events.clear();
+    plugin->setParameter(1, value14(0x0281));
+    jackbridge_fake_run_cycles(1);
+
+    JACKASS_CHECK(sink.events.size() == 4);
+
+    if (sink.events.size() == 4)
+    {
+        JACKASS_CHECK(isMessage(sink.events[0], 0xB0, 0x63, 0x04));
+        JACKASS_CHECK(isMessage(sink.events[1], 0xB0, 0x62, 0x05));
+        JACKASS_CHECK(isMessage(sink.events[2], 0xB0, 0x06, 0x05));
+        JACKASS_CHECK(isMessage(sink.events[3], 0xB0, 0x26, 0x01));
+    }
+
+    sink.events.clear();
+    plugin->setParameter(1, value14(0x0282));
+    jackbridge_fake_run_cycles(1);
+
+    JACKASS_CHECK(sink.events.size() == 1 && isMessage(sink.events[0], 0xB0, 0x26, 0x02));
+
+    // a new receiver gets both in full
+    JACKASS_CHECK(sink.disconnect("JackAss:midi-out_01"));
+    jackbridge_fake_run_cycles(1);
+    sink.events.clear();
+
+    JACKASS_CHECK(sink.connect("JackAss:midi-out_01"));
+    jackbridge_fake_run_cycles(2);
+
+    int found14 = 0, foundNrpn = 0;
+
+    for (size_t i=0; i < sink.events.size(); ++i)
+    {
+        if (i+1 < sink.events.size() && isMessage(sink.events[i], 0xB0, 1, 0x24) && isMessage(sink.events[i+1], 0xB0, 33, 0x35))
+            ++found14;
+
+        if (i+3 < sink.events.size() && isMessage(sink.events[i],   0xB0, 0x63, 0x04) && isMessage(sink.events[i+1], 0xB0, 0x62, 0x05) &&
+                                        isMessage(sink.events[i+2], 0xB0, 0x06, 0x05) && isMessage(sink.events[i+3], 0xB0, 0x26, 0x02))
+            ++foundNrpn;
+    }
+
+    JACKASS_CHECK(found14 == 1);
+    JACKASS_CHECK(foundNrpn == 1);
+
+    delete plugin;
+
+    return testResult("TestParamModes");
+}
@@ -0,0 +1,72 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// Parameter rate limit, run with JACKASS_PARAM_RATE="1=10" (CC 1, 10 messages per second).
+// A burst sends its first value at once, and its last one after the burst settled.
+
+#include "JackAssTest.hpp"
+
+static const jack_nframes_t kSampleRate = 48000;
+static const jack_nframes_t kBufferSize = 256;
+
+int main()
+{
+    jackbridge_fake_set_engine(kSampleRate, kBufferSize, false);
+
+    JACKASS_CHECK(gParamLimitMap.rate[0] == 10);
+
+    JackAss* const plugin(new JackAss(testAudioMaster));
+    TestMidiSink sink("sink");
+
+    JACKASS_CHECK(sink.connect("JackAss:midi-out_01"));
+    jackbridge_fake_run_cycles(2);
+    sink.events.clear();
+
+    // a burst of 10 values, one per cycle
+    for (int i=1; i <= 10; ++i)
+    {
+        plugin->setParameter(0, float(i*10)/127.0f + 0.001f);
+        jackbridge_fake_run_cycles(1);
+    }
+
+    JACKASS_CHECK(sink.events.size() == 1);
+    JACKASS_CHECK(sink.events.size() >= 1 && sink.events[0].data[1] == 1 && sink.events[0].data[2] == 10);
+
+    // the last value goes out once the interval since the first one has passed, and only once
+    const uint32_t intervalCycles(kSampleRate / 10 / kBufferSize + 1);
+    jackbridge_fake_run_cycles(intervalCycles);
+
+    JACKASS_CHECK(sink.events.size() == 2);
+
+    if (sink.events.size() == 2)
+    {
+        JACKASS_CHECK(sink.events[1].data[1] == 1 && sink.events[1].data[2] == 100);
+        JACKASS_CHECK(sink.events[1].frame >= sink.events[0].frame + kSampleRate / 10);
+    }
+
+    jackbridge_fake_run_cycles(intervalCycles);
+    JACKASS_CHECK(sink.events.size() == 2);
+
+    // a change after a quiet period goes out at once
+    plugin->setParameter(0, 20.0f/127.0f + 0.001f);
+    jackbridge_fake_run_cycles(1);
+
+    JACKASS_CHECK(sink.events.size() == 3 && sink.events.back().data[2] == 20);
+
+    delete plugin;
+
+    return testResult("TestParamRate");
+}
@@ -0,0 +1,226 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// DIN shaper: events leave at wire speed, notes overtake waiting CCs, and the worst note
+// delay of a known burst is what the cable model says.
+// Under a CC flood above the wire rate, note delay through the cable stays bounded with the
+// shaper and keeps growing without it.
+
+#include "JackAssTest.hpp"
+
+static const jack_nframes_t kSampleRate = 48000;
+static const jack_nframes_t kBufferSize = 256;
+
+static JackAssDinShaper* gShaper = nullptr;
+static jack_port_t*      gPort   = nullptr;
+
+// without the shaper, events go to the port as they come
+static bool gBypass = false;
+static std::vector<TestMidiEvent> gBypassEvents;
+
+static int shaperProcess(const jack_nframes_t nframes, void*)
+{
+    if (void* const buffer = jackbridge_port_get_buffer(gPort, nframes))
+    {
+        jackbridge_midi_clear_buffer(buffer);
+
+        if (gBypass)
+        {
+            for (size_t i=0; i < gBypassEvents.size(); ++i)
+                jackbridge_midi_event_write(buffer, jack_nframes_t(gBypassEvents[i].frame), gBypassEvents[i].data, gBypassEvents[i].size);
+
+            gBypassEvents.clear();
+        }
+        else
+        {
+            gShaper->write(buffer, nframes);
+        }
+    }
+
+    return 0;
+}
+
+static void put(const unsigned char status, const unsigned char data1, const jack_nframes_t time)
+{
+    const unsigned char data[3] = { status, data1, 100 };
+
+    if (gBypass)
+    {
+        TestMidiEvent event;
+        event.frame = time;
+        event.size  = 3;
+        std::memcpy(event.data, data, 3);
+        event.data[3] = 0;
+        gBypassEvents.push_back(event);
+        return;
+    }
+
+    gShaper->put(data, 3, time);
+}
+
+// 16 CCs and one note per cycle, about 3 times what the cable carries, for 60 cycles.
+// The sink output then goes through a FIFO cable model, as the MIDI interface would do.
+// Returns the worst note delay at the cable end in the first and second half of the flood.
+static void runFlood(const bool shaped, uint64_t worst[2])
+{
+    static const int kFloodCycles = 60;
+    static const jack_nframes_t kNoteFrame = 120;
+
+    gBypass = ! shaped;
+
+    JackAssDinShaper shaper(kSampleRate);
+    gShaper = &shaper;
+
+    TestMidiSink sink(shaped ? "flood-shaped" : "flood-direct");
+    JACKASS_CHECK(sink.connect("shaper:out"));
+
+    for (int k=0; k < kFloodCycles; ++k)
+    {
+        for (int i=0; i < 16; ++i)
+        {
+            if (jack_nframes_t(i*16) == kNoteFrame + 8)
+                put(0x90, (unsigned char)(36 + k), kNoteFrame);
+
+            put(0xB0, (unsigned char)i, jack_nframes_t(i*16));
+        }
+
+        jackbridge_fake_run_cycles(1);
+    }
+
+    // leave time for the notes, CCs can stay behind
+    gBypassEvents.clear();
+    jackbridge_fake_run_cycles(4);
+
+    const double framesPerByte(double(kSampleRate) / kDinBytesPerSecond);
+    double wireFree = 0.0;
+    int note = 0;
+
+    worst[0] = worst[1] = 0;
+
+    for (size_t i=0; i < sink.events.size(); ++i)
+    {
+        const TestMidiEvent& event(sink.events[i]);
+
+        const double start((double(event.frame) > wireFree) ? double(event.frame) : wireFree);
+        wireFree = start + double(event.size) * framesPerByte;
+
+        if (event.data[0] != 0x90)
+            continue;
+
+        JACKASS_CHECK(event.data[1] == 36 + note);
+
+        const uint64_t sent(uint64_t(note) * kBufferSize + kNoteFrame);
+        const uint64_t delay(uint64_t(wireFree) - sent);
+        uint64_t& half(worst[(note < kFloodCycles/2) ? 0 : 1]);
+
+        if (delay > half)
+            half = delay;
+
+        ++note;
+    }
+
+    JACKASS_CHECK(note == kFloodCycles);
+    JACKASS_CHECK(shaper.getDropped() == 0);
+
+    sink.disconnect("shaper:out");
+    gBypass = false;
+}
+
+int main()
+{
+    jackbridge_fake_set_engine(kSampleRate, kBufferSize, false);
+
+    JackAssDinShaper shaper(kSampleRate);
+    gShaper = &shaper;
+
+    jack_client_t* const client(jackbridge_client_open("shaper", JackNullOption, nullptr));
+    gPort = jackbridge_port_register(client, "out", JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0);
+    jackbridge_set_process_callback(client, shaperProcess, nullptr);
+    jackbridge_activate(client);
+
+    TestMidiSink sink("sink");
+    JACKASS_CHECK(sink.connect("shaper:out"));
+
+    // 16 CCs at frame 0, then 8 notes at frame 10. One CC is already on the wire when the
+    // notes arrive, then the notes go before the other CCs
+    for (int i=0; i < 16; ++i)
+        put(0xB0, (unsigned char)i, 0);
+    for (int i=0; i < 8; ++i)
+        put(0x90, (unsigned char)(60+i), 10);
+
+    jackbridge_fake_run_cycles(8);
+
+    const double framesPerByte(double(kSampleRate) / kDinBytesPerSecond);
+    const uint32_t expectedDelay(uint32_t(framesPerByte*3*8 - 10));
+
+    JACKASS_CHECK(shaper.getMaxNoteDelay() == expectedDelay);
+    JACKASS_CHECK(shaper.getDropped() == 0);
+    JACKASS_CHECK(sink.events.size() == 24);
+
+    if (sink.events.size() == 24)
+    {
+        JACKASS_CHECK(sink.events[0].data[0] == 0xB0 && sink.events[0].frame == 0);
+
+        for (int i=1; i <= 8; ++i)
+            JACKASS_CHECK(sink.events[i].data[0] == 0x90 && sink.events[i].data[1] == 60+i-1);
+
+        for (int i=9; i < 24; ++i)
+            JACKASS_CHECK(sink.events[i].data[0] == 0xB0);
+
+        // never faster than the cable
+        for (int i=1; i < 24; ++i)
+            JACKASS_CHECK(double(sink.events[i].frame - sink.events[i-1].frame) >= framesPerByte*3 - 1.0);
+    }
+
+    // a clock overtakes waiting notes
+    sink.events.clear();
+    shaper.reset();
+
+    for (int i=0; i < 4; ++i)
+        put(0x90, (unsigned char)(60+i), 0);
+
+    const unsigned char clock[1] = { 0xF8 };
+    shaper.put(clock, 1, 1);
+
+    jackbridge_fake_run_cycles(2);
+
+    JACKASS_CHECK(sink.events.size() == 5);
+    JACKASS_CHECK(sink.events.size() == 5 && sink.events[1].data[0] == 0xF8);
+
+    // sustained flood, shaper in and out
+    const double eventFrames(double(kSampleRate) / kDinBytesPerSecond * 3);
+    uint64_t shapedWorst[2], directWorst[2];
+
+    runFlood(true, shapedWorst);
+    runFlood(false, directWorst);
+    gShaper = &shaper;
+
+    std::printf("flood note delay, shaped: %llu then %llu frames, direct: %llu then %llu frames\n",
+                (unsigned long long)shapedWorst[0], (unsigned long long)shapedWorst[1],
+                (unsigned long long)directWorst[0], (unsigned long long)directWorst[1]);
+
+    // shaped: at most the CC on the wire, the note itself and cycle rounding
+    JACKASS_CHECK(double(shapedWorst[0]) <= eventFrames*2 + 1.0);
+    JACKASS_CHECK(double(shapedWorst[1]) <= eventFrames*2 + 1.0);
+
+    // direct: the cable backlog grows with every cycle of the flood
+    JACKASS_CHECK(directWorst[0] > kBufferSize * 4);
+    JACKASS_CHECK(directWorst[1] > directWorst[0] * 3 / 2);
+
+    jackbridge_client_close(client);
+
+    return testResult("TestShaper");
+}
@@ -0,0 +1,141 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// Shared memory ring: only the owner can open it, a reader that died while attached
+// does not lock the next one out, and a reader sleeping in wait() is woken by every write.
+
+#include "JackAssTest.hpp"
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#ifndef JACKASS_SHM_UNSUPPORTED
+static void testAttach(const char* const name)
+{
+    JackAssShmOutput output;
+    JACKASS_CHECK(output.open(name, 48000));
+
+    const int fd(::shm_open(name, O_RDONLY, 0));
+    struct stat st;
+    JACKASS_CHECK(fd >= 0 && ::fstat(fd, &st) == 0 && (st.st_mode & 0777) == 0600);
+    ::close(fd);
+
+    // a reader that exits without closing
+    const pid_t child(::fork());
+
+    if (child == 0)
+    {
+        JackAssShmReader reader;
+        ::_exit(reader.open(name) ? 0 : 1);
+    }
+
+    int status = -1;
+    ::waitpid(child, &status, 0);
+    JACKASS_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    JACKASS_CHECK(output.isConnected());
+
+    // its slot is taken over, and the live reader keeps it
+    JackAssShmReader reader, second;
+    JACKASS_CHECK(reader.open(name));
+    JACKASS_CHECK(! second.open(name));
+
+    const unsigned char data[4] = { 0x90, 60, 100, 0 };
+    JACKASS_CHECK(output.write(data, 3, 0, 1234));
+
+    capture_event_t event;
+    JACKASS_CHECK(reader.read(&event, 1) == 1 && event.frame == 1234 && event.data[1] == 60);
+
+    reader.close();
+    JACKASS_CHECK(! output.isConnected());
+    JACKASS_CHECK(second.open(name));
+}
+
+// a lost wakeup shows up as a reader sleeping until its timeout
+static const int  kWakeups       = 500;
+static const long kWaitTimeoutMs = 2000;
+
+static JackAssShmReader gWakeReader;
+static double           gSentAt[kWakeups];
+static double           gMaxLatency = 0.0;
+
+static void* wakeReader(void*)
+{
+    capture_event_t events[16];
+
+    for (int received = 0; received < kWakeups;)
+    {
+        const uint32_t count(gWakeReader.read(events, 16));
+
+        if (count == 0)
+        {
+            gWakeReader.wait(kWaitTimeoutMs);
+            continue;
+        }
+
+        const double now(benchTime());
+
+        for (uint32_t i=0; i < count; ++i, ++received)
+        {
+            const double latency(now - gSentAt[events[i].frame]);
+
+            if (latency > gMaxLatency)
+                gMaxLatency = latency;
+        }
+    }
+
+    return nullptr;
+}
+
+static void testWakeup(const char* const name)
+{
+    JackAssShmOutput output;
+    JACKASS_CHECK(output.open(name, 48000));
+    JACKASS_CHECK(gWakeReader.open(name));
+
+    pthread_t thread;
+    pthread_create(&thread, nullptr, wakeReader, nullptr);
+
+    const unsigned char data[4] = { 0x90, 60, 100, 0 };
+
+    // paced so the reader is asleep in wait() most of the time
+    for (int i=0; i < kWakeups; ++i)
+    {
+        gSentAt[i] = benchTime();
+        JACKASS_CHECK(output.write(data, 3, 0, uint64_t(i)));
+        ::usleep(200);
+    }
+
+    pthread_join(thread, nullptr);
+    gWakeReader.close();
+
+    JACKASS_CHECK(gMaxLatency < double(kWaitTimeoutMs) / 1000.0 / 4);
+}
+#endif
+
+int main()
+{
+#ifndef JACKASS_SHM_UNSUPPORTED
+    char name[64];
+
+    std::snprintf(name, sizeof(name), "/jackass-test-%i", int(::getpid()));
+    testAttach(name);
+
+    std::snprintf(name, sizeof(name), "/jackass-test-%i-wake", int(::getpid()));
+    testWakeup(name);
+#endif
+
+    return testResult("TestShm");
+}
@@ -0,0 +1,70 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// Plugin state: a saved chunk restores, and a corrupt one cannot set bad values or
+// make setChunk read past its end.
+
+#include "JackAssTest.hpp"
+
+#include <limits>
+
+int main()
+{
+    jackbridge_fake_set_engine(48000, 256, false);
+
+    JackAss* const plugin(new JackAss(testAudioMaster));
+
+    plugin->setParameter(0, 0.5f);
+
+    void* data = nullptr;
+    const VstInt32 byteSize(plugin->getChunk(&data, false));
+    JACKASS_CHECK(byteSize > VstInt32(sizeof(state_header_t) + sizeof(state_param_t)));
+
+    std::vector<unsigned char> chunk((unsigned char*)data, (unsigned char*)data + byteSize);
+    state_header_t header;
+    std::memcpy(&header, &chunk[0], sizeof(state_header_t));
+
+    // round trip
+    plugin->setParameter(0, 0.0f);
+    JACKASS_CHECK(plugin->setChunk(&chunk[0], byteSize, false) == 1);
+    JACKASS_CHECK(plugin->getParameter(0) == 0.5f);
+
+    // NaN is not a value in range
+    std::vector<unsigned char> nanChunk(chunk);
+    state_param_t param;
+    std::memcpy(&param, &nanChunk[sizeof(state_header_t)], sizeof(state_param_t));
+    param.value = std::numeric_limits<float>::quiet_NaN();
+    std::memcpy(&nanChunk[sizeof(state_header_t)], &param, sizeof(state_param_t));
+
+    plugin->setParameter(0, 0.25f);
+    JACKASS_CHECK(plugin->setChunk(&nanChunk[0], byteSize, false) == 1);
+    JACKASS_CHECK(plugin->getParameter(0) == 0.25f);
+
+    // a names size that would wrap the total around is rejected
+    std::vector<unsigned char> bigChunk(chunk);
+    state_header_t bigHeader(header);
+    bigHeader.namesSize = 0xFFFFFFFFU - uint32_t(sizeof(state_param_t)*header.paramCount) + 1;
+    std::memcpy(&bigChunk[0], &bigHeader, sizeof(state_header_t));
+    JACKASS_CHECK(plugin->setChunk(&bigChunk[0], byteSize, false) == 0);
+
+    bigHeader.namesSize = header.namesSize + 1;
+    std::memcpy(&bigChunk[0], &bigHeader, sizeof(state_header_t));
+    JACKASS_CHECK(plugin->setChunk(&bigChunk[0], byteSize, false) == 0);
+
+    delete plugin;
+
+    return testResult("TestState");
+}
@@ -0,0 +1,82 @@
+/*
+ * JackAss VST plugin
+ * Copyright (C) 2013-2014 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// Transform stage: parameter values sent on connection go through it like live events.
+
+#include "JackAssTest.hpp"
+
+// parameter 0 is CC 1 on channel 1
+static void testResendRemapped()
+{
+    setenv("JACKASS_TRANSFORM", "channel=1:5", 1);
+
+    JackAss* const plugin(new JackAss(testAudioMaster));
+    TestMidiSink sink("sink");
+
+    plugin->setParameter(0, 0.5f);
+
+    JACKASS_CHECK(sink.connect("JackAss:midi-out_01"));
+    jackbridge_fake_run_cycles(2);
+
+    bool found = false;
+
+    for (size_t i=0; i < sink.events.size(); ++i)
+    {
+        if (sink.events[i].data[1] != 0x01)
+            continue;
+
+        JACKASS_CHECK(sink.events[i].data[0] == 0xB4);
+        found = true;
+    }
+
+    JACKASS_CHECK(found);
+
+    // live changes agree with the resend
+    sink.events.clear();
+    plugin->setParameter(0, 0.25f);
+    jackbridge_fake_run_cycles(1);
+    JACKASS_CHECK(sink.events.size() == 1 && sink.events[0].data[0] == 0xB4);
+
+    delete plugin;
+}
+
+static void testResendFiltered()
+{
+    setenv("JACKASS_TRANSFORM", "filter=cc", 1);
+
+    JackAss* const plugin(new JackAss(testAudioMaster));
+    TestMidiSink sink("sink");
+
+    plugin->setParameter(0, 0.5f);
+
+    JACKASS_CHECK(sink.connect("JackAss:midi-out_01"));
+    jackbridge_fake_run_cycles(2);
+
+    for (size_t i=0; i < sink.events.size(); ++i)
+        JACKASS_CHECK((sink.events[i].data[0] & 0xF0) != 0xB0);
+
+    delete plugin;
+}
+
+int main()
+{
+    jackbridge_fake_set_engine(48000, 256, false);
+
+    testResendRemapped();
+    testResendFiltered();
+
+    return testResult("TestTransform");
+}